@@ -6,6 +6,8 @@ import android.view.View;
 import android.widget.Button;
 import android.widget.TextView;
 
+import java.io.File;
+
 public class MainActivity extends AppCompatActivity {
 
     @Override
@@ -13,6 +15,8 @@ public class MainActivity extends AppCompatActivity {
         super.onCreate(savedInstanceState);
         setContentView(R.layout.activity_main);
 
+        MyLib.setCrashDumpFile(new File(getFilesDir(), "crash.txt").getPath());
+
         final Button button = (Button) findViewById(R.id.crash_btn);
         button.setOnClickListener(new View.OnClickListener() {
             public void onClick(View v) {
@@ -13,6 +13,7 @@ public class MyLib {
         Log.d("mylib", "mylib loaded");
     }
 
+    public static native void setCrashDumpFile(String path);
     public static native void boom();
     public static native void throwException() throws java.lang.Error;
 }
@@ -1,19 +1,28 @@
 #include "Callstack.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <iomanip>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #define PLATFORM_WIN     1
 #define PLATFORM_APPLE   2
 #define PLATFORM_ANDROID 3
+#define PLATFORM_LINUX   4
 
 // PLATFORM_LINUX != PLATFORM_ANDROID
 
 #ifndef PLATFORM_CURRENT
 #   if defined(_WIN32)
-#       define PLAFTORM_CURRENT PLATFORM_WIN
+#       define PLATFORM_CURRENT PLATFORM_WIN
 #   elif defined(__APPLE__)
 #       define PLATFORM_CURRENT PLATFORM_APPLE
 #   elif defined(ANDROID)
@@ -36,6 +45,8 @@
 #       define BACKTRACE_WAY BACKTRACE_GCC
 #   elif PLATFORM_CURRENT == PLATFORM_ANDROID
 #       define BACKTRACE_WAY BACKTRACE_UNWIND
+#   elif PLATFORM_CURRENT == PLATFORM_LINUX
+#       define BACKTRACE_WAY BACKTRACE_UNWIND
 #   else
 #       error Undefined backtrace
 #   endif
@@ -52,6 +63,8 @@
 #       define SYMBOLIZATION_WAY SYMBOLIZATION_GCC
 #   elif PLATFORM_CURRENT == PLATFORM_ANDROID
 #       define SYMBOLIZATION_WAY SYMBOLIZATION_MANUAL
+#   elif PLATFORM_CURRENT == PLATFORM_LINUX
+#       define SYMBOLIZATION_WAY SYMBOLIZATION_MANUAL
 #   else
 #       error Undefined symbolization
 #   endif
@@ -73,6 +86,14 @@
 #   endif
 #endif // HAS_DLFCN
 
+#ifndef HAS_DLADDR1
+#   if HAS_DLFCN && defined(__GLIBC__)
+#       define HAS_DLADDR1 1
+#   else
+#       define HAS_DLADDR1 0
+#   endif
+#endif // HAS_DLADDR1
+
 #ifndef HAS_PROCFS
 #   if PLATFORM_CURRENT == PLATFORM_LINUX
 #       define HAS_PROCFS 1
@@ -81,6 +102,22 @@
 #   endif
 #endif // HAS_PROCFS
 
+#ifndef HAS_PHDR_ITERATE
+#   if PLATFORM_CURRENT == PLATFORM_LINUX
+#       define HAS_PHDR_ITERATE 1
+#   elif PLATFORM_CURRENT == PLATFORM_ANDROID
+#       include <android/api-level.h>
+// bionic exports dl_iterate_phdr on every architecture from API 21
+#       if __ANDROID_API__ >= 21
+#           define HAS_PHDR_ITERATE 1
+#       else
+#           define HAS_PHDR_ITERATE 0
+#       endif
+#   else
+#       define HAS_PHDR_ITERATE 0
+#   endif
+#endif // HAS_PHDR_ITERATE
+
 #ifndef USE_HASH
 #   if BACKTRACE_WAY == BACKTRACE_WIN
 #       define USE_HASH 1
@@ -89,6 +126,15 @@
 #   endif
 #endif // USE_HASH
 
+// Budget in bytes of the address -> symbolized entry cache, 0 disables the cache
+#ifndef SYMBOL_CACHE_SIZE
+#   define SYMBOL_CACHE_SIZE (1024 * 1024)
+#endif // SYMBOL_CACHE_SIZE
+
+#ifndef SYMBOL_CACHE_SHARDS
+#   define SYMBOL_CACHE_SHARDS 16
+#endif // SYMBOL_CACHE_SHARDS
+
 #if BACKTRACE_WAY == BACKTRACE_WIN
 #   include <cstdint>
     using HashType = std::uint64_t;
@@ -112,11 +158,22 @@
 #endif // SYMBOLIZATION_WAY == SYMBOLIZATION_WIN
 
 #if HAS_PROCFS
+#   include <cstdio>
 #   include <fstream>
-#   include <functional>
-#   include <list>
+#   include <mutex>
+#   include <vector>
 #endif // HAS_PROCFS
 
+#if HAS_PHDR_ITERATE
+#   include <cstddef>
+#   include <link.h>
+#endif // HAS_PHDR_ITERATE
+
+#if SYMBOL_CACHE_SIZE
+#   include <mutex>
+#   include <unordered_map>
+#endif // SYMBOL_CACHE_SIZE
+
 #if HAS_CXXABI
 #   include <cxxabi.h>
 #endif // HAS_CXXABI
@@ -125,6 +182,10 @@
 #   include <dlfcn.h>
 #endif // HAS_DLFCN
 
+#if HAS_DLADDR1
+#   include <link.h>
+#endif // HAS_DLADDR1
+
 using namespace Navionics;
 
 namespace
@@ -136,16 +197,25 @@ std::size_t Backtrace(std::size_t ignore, void** addresses, std::size_t limit)
 {
     ++ignore;
 
-    std::size_t               stackSize = stackSize = ignore + limit;
-    std::unique_ptr<void* []> buf(new void*[stackSize]);
-    stackSize = ::backtrace(buf.get(), (int) stackSize);
+    // backtrace() cannot skip frames, the ignored ones go to a scratch buffer on the stack
+    // unless the request does not fit it
+    void*                     local[Callstack::MaxStackLimit + 16];
+    std::unique_ptr<void* []> heap;
+    std::size_t               stackSize = ignore + limit;
+    void**                    buf       = local;
+    if (stackSize > sizeof(local) / sizeof(local[0]))
+    {
+        heap.reset(new void*[stackSize]);
+        buf = heap.get();
+    }
+    stackSize = ::backtrace(buf, (int) stackSize);
 
     if (ignore >= stackSize)
     {
         return 0;
     }
     stackSize -= ignore;
-    std::memcpy(addresses, buf.get() + ignore, stackSize * sizeof(void*));
+    std::memcpy(addresses, buf + ignore, stackSize * sizeof(void*));
     return stackSize;
 }
 
@@ -408,6 +478,129 @@ private:
 
 #endif // SYMBOLIZATION_WAY == SYMBOLIZATION_GCC
 
+#if HAS_PHDR_ITERATE
+
+int AccumulateGeneration(dl_phdr_info* info, std::size_t size, void* data)
+{
+    unsigned long long& generation = *static_cast<unsigned long long*>(data);
+#if defined(__GLIBC__)
+    // glibc keeps global load/unload counters, the first module is enough
+    if (size >= offsetof(dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs))
+    {
+        generation = info->dlpi_adds + info->dlpi_subs;
+        return 1;
+    }
+#endif
+    // otherwise fingerprint the set of loaded modules by their bases
+    generation = generation * 31 + info->dlpi_addr + 1;
+    return 0;
+}
+
+// Changes whenever a module is loaded or unloaded
+unsigned long long ModuleGeneration()
+{
+    unsigned long long generation = 0;
+    dl_iterate_phdr(AccumulateGeneration, &generation);
+    return generation;
+}
+
+#else // HAS_PHDR_ITERATE
+
+inline unsigned long long ModuleGeneration()
+{
+    return 0;
+}
+
+#endif // HAS_PHDR_ITERATE
+
+// Module generation the symbolization caches were built for
+std::atomic<unsigned long long> g_moduleGeneration(ModuleGeneration());
+
+// Code of the modules loaded at some point, see Callstack::SnapshotModules
+struct ModuleSnapshot
+{
+    struct Module
+    {
+        std::uintptr_t Start; // executable segment
+        std::uintptr_t End;
+        std::uintptr_t Base; // load bias, offsets in the module file are relative to it
+        std::string    Path; // empty for the main program
+    };
+
+    unsigned long long  Generation;
+    std::vector<Module> Modules; // sorted by Start
+
+    Module const* Find(void const* address) const
+    {
+        std::uintptr_t value = reinterpret_cast<std::uintptr_t>(address);
+        std::vector<Module>::const_iterator it =
+            std::upper_bound(Modules.begin(), Modules.end(), value,
+                             [](std::uintptr_t value, Module const& module) {
+                                 return value < module.Start;
+                             });
+        if (it != Modules.begin() && value < (--it)->End)
+        {
+            return &*it;
+        }
+        return nullptr;
+    }
+};
+
+using ModuleSnapshotPtr = std::shared_ptr<ModuleSnapshot const>;
+
+#if HAS_PHDR_ITERATE
+
+int AddModule(dl_phdr_info* info, std::size_t, void* data)
+{
+    std::vector<ModuleSnapshot::Module>& modules =
+        *static_cast<std::vector<ModuleSnapshot::Module>*>(data);
+    for (ElfW(Half) i = 0; i < info->dlpi_phnum; ++i)
+    {
+        ElfW(Phdr) const& header = info->dlpi_phdr[i];
+        if (header.p_type == PT_LOAD && (header.p_flags & PF_X) != 0)
+        {
+            ModuleSnapshot::Module module;
+            module.Start = info->dlpi_addr + header.p_vaddr;
+            module.End   = module.Start + header.p_memsz;
+            module.Base  = info->dlpi_addr;
+            module.Path  = (info->dlpi_name != nullptr) ? info->dlpi_name : "";
+            modules.push_back(module);
+        }
+    }
+    return 0;
+}
+
+// The modules loaded now, the snapshot is shared until a module is loaded or unloaded
+ModuleSnapshotPtr CurrentModuleSnapshot()
+{
+    static std::mutex        mutex;
+    static ModuleSnapshotPtr current;
+
+    unsigned long long          generation = ModuleGeneration();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (current == nullptr || current->Generation != generation)
+    {
+        std::shared_ptr<ModuleSnapshot> snapshot = std::make_shared<ModuleSnapshot>();
+        snapshot->Generation                     = generation;
+        dl_iterate_phdr(AddModule, &snapshot->Modules);
+        std::sort(snapshot->Modules.begin(), snapshot->Modules.end(),
+                  [](ModuleSnapshot::Module const& left, ModuleSnapshot::Module const& right) {
+                      return left.Start < right.Start;
+                  });
+        current = snapshot;
+    }
+    return current;
+}
+
+#else // HAS_PHDR_ITERATE
+
+inline ModuleSnapshotPtr CurrentModuleSnapshot()
+{
+    return nullptr;
+}
+
+#endif // HAS_PHDR_ITERATE
+
 #if HAS_PROCFS
 class ProcFsMapping
 {
@@ -425,15 +618,18 @@ class ProcFsMapping
         }
     };
 
-    using Regions = std::list<Region>;
-    Regions m_regions;
+    // sorted by Start, regions never overlap
+    using Regions = std::vector<Region>;
+    using Lock    = std::lock_guard<std::mutex>;
 
-public:
-    ProcFsMapping()
+    std::mutex         m_mutex;
+    Regions            m_regions;
+    unsigned long long m_generation;
+
+    void Load()
     {
-        std::stringstream pathStream;
-        pathStream << "/proc/" << getpid() << "/maps";
-        std::ifstream fileStream(pathStream.str().c_str());
+        m_regions.clear();
+        std::ifstream fileStream("/proc/self/maps");
         while (fileStream.good())
         {
             std::string line;
@@ -459,18 +655,39 @@ public:
                 m_regions.push_back(region);
             }
         }
+        std::sort(m_regions.begin(), m_regions.end(),
+                  [](Region const& left, Region const& right) { return left.Start < right.Start; });
     }
 
-    char const* GetModuleName(void const* address) const
+public:
+    ProcFsMapping()
+        : m_mutex()
+        , m_regions()
+        , m_generation(g_moduleGeneration.load())
     {
+        Load();
+    }
+
+    // The returned name stays valid even if the table is reloaded meanwhile
+    std::shared_ptr<char> GetModuleName(void const* address)
+    {
+        Lock lock(m_mutex);
+        unsigned long long generation = g_moduleGeneration.load();
+        if (generation != m_generation)
+        {
+            // modules were loaded or unloaded since the last parse
+            Load();
+            m_generation = generation;
+        }
+
         Regions::const_iterator it =
-            std::find_if(m_regions.begin(), m_regions.end(),
-                         [address](Region const& region) {
-                             return region.Start <= address && region.End > address;
-                         });
-        if (it != m_regions.end())
+            std::upper_bound(m_regions.begin(), m_regions.end(), address,
+                             [](void const* address, Region const& region) {
+                                 return address < region.Start;
+                             });
+        if (it != m_regions.begin() && (--it)->End > address)
         {
-            return it->ModuleName.get();
+            return it->ModuleName;
         }
         return nullptr;
     }
@@ -482,7 +699,8 @@ inline void OutputAddress(std::ostream& stream, void const* address)
 {
     std::ios_base::fmtflags oldFlags = stream.flags();
     stream << "[";
-    stream << std::hex << std::setfill('0') << std::setw(sizeof(void*) << 1) << address;
+    stream << std::hex << std::setfill('0') << std::setw(sizeof(void*) << 1)
+           << reinterpret_cast<std::uintptr_t>(address);
     stream.flags(oldFlags);
     stream << "]";
 }
@@ -585,6 +803,7 @@ void OutputEntryWide(std::ostream& stream, void const* address)
     info.dli_fname = nullptr;
     info.dli_sname = nullptr;
     info.dli_saddr = nullptr;
+    info.dli_fbase = nullptr;
     if (dladdr(address, &info) != 0)
     {
         module = FileNameFromPath(info.dli_fname);
@@ -592,15 +811,19 @@ void OutputEntryWide(std::ostream& stream, void const* address)
         {
             function = info.dli_sname;
         }
-        offset = static_cast<char const*>(address) - static_cast<char const*>(info.dli_saddr);
+        // without a symbol the offset is relative to the module base
+        void const* base = (info.dli_saddr != nullptr) ? info.dli_saddr : info.dli_fbase;
+        offset = static_cast<char const*>(address) - static_cast<char const*>(base);
     }
 #endif
 
 #if HAS_PROCFS
+    std::shared_ptr<char> mappedModule;
     if (module == nullptr)
     {
         static ProcFsMapping mapping;
-        module = mapping.GetModuleName(address);
+        mappedModule = mapping.GetModuleName(address);
+        module       = mappedModule.get();
     }
 #endif
 
@@ -648,25 +871,176 @@ void OutputEntryWide(std::ostream& stream, void const* address)
     }
 }
 
+// Frame of a module unloaded or replaced since the capture: what is mapped there now is unrelated,
+// so only the module and the offset in it are shown, enough to symbolize the frame offline
+void OutputEntryUnloaded(std::ostream& stream, void const* address,
+                         ModuleSnapshot::Module const& module, bool tiny)
+{
+    char const* name = module.Path.empty() ? nullptr : FileNameFromPath(module.Path.c_str());
+    std::size_t offset = reinterpret_cast<std::uintptr_t>(address) - module.Base;
+    if (tiny)
+    {
+        stream << ((name == nullptr) ? "<unknown>" : name) << '+';
+        OutputOffset(stream, offset);
+        return;
+    }
+    OutputAddress(stream, address);
+    stream << ' ';
+    OutputModule(stream, name);
+    stream << " ??? + ";
+    OutputOffset(stream, offset);
+    stream << " (unloaded since capture)";
+}
+
+#if SYMBOL_CACHE_SIZE
+
+// Symbolized entries of already seen addresses.
+// Split into independently locked shards so concurrent formatting rarely contends,
+// each shard evicts its oldest-inserted entries once it exceeds its part of the budget.
+class SymbolCache
+{
+    static std::size_t const ShardBudget = SYMBOL_CACHE_SIZE / SYMBOL_CACHE_SHARDS;
+    // rough per entry cost of the hash node and of its place in the insertion order besides the text itself
+    static std::size_t const EntryOverhead = 5 * sizeof(void*) + sizeof(std::string);
+
+    using EntryMap = std::unordered_map<void const*, std::string>;
+
+    struct alignas(64) Shard
+    {
+        std::mutex              Mutex;
+        EntryMap                Entries;
+        std::deque<void const*> Order; // keys of Entries, oldest first
+        std::size_t             Bytes;
+
+        Shard()
+            : Mutex()
+            , Entries()
+            , Order()
+            , Bytes()
+        {
+        }
+    };
+
+    Shard m_shards[SYMBOL_CACHE_SHARDS];
+
+    Shard& ShardOf(void const* address)
+    {
+        // code addresses are clustered, mix the bits before picking a shard
+        std::uint64_t key = reinterpret_cast<std::uintptr_t>(address);
+        key               = (key ^ (key >> 17)) * 0x9E3779B97F4A7C15ull;
+        return m_shards[(key >> 32) % SYMBOL_CACHE_SHARDS];
+    }
+
+public:
+    bool Find(void const* address, std::string& text)
+    {
+        Shard&                      shard = ShardOf(address);
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        EntryMap::const_iterator    it = shard.Entries.find(address);
+        if (it == shard.Entries.end())
+        {
+            return false;
+        }
+        text = it->second;
+        return true;
+    }
+
+    void Insert(void const* address, std::string const& text)
+    {
+        std::size_t const bytes = text.size() + EntryOverhead;
+        if (bytes > ShardBudget)
+        {
+            return;
+        }
+
+        Shard&                      shard = ShardOf(address);
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        if (shard.Entries.find(address) != shard.Entries.end())
+        {
+            return;
+        }
+        while (shard.Bytes + bytes > ShardBudget && !shard.Order.empty())
+        {
+            EntryMap::iterator victim = shard.Entries.find(shard.Order.front());
+            shard.Order.pop_front();
+            shard.Bytes -= victim->second.size() + EntryOverhead;
+            shard.Entries.erase(victim);
+        }
+        shard.Entries.insert(std::make_pair(address, text));
+        shard.Order.push_back(address);
+        shard.Bytes += bytes;
+    }
+
+    void Clear()
+    {
+        for (Shard& shard : m_shards)
+        {
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+            shard.Entries.clear();
+            shard.Order.clear();
+            shard.Bytes = 0;
+        }
+    }
+};
+
+SymbolCache& SymbolCacheFor(bool tiny)
+{
+    static SymbolCache wide;
+    static SymbolCache tinyCache;
+    return tiny ? tinyCache : wide;
+}
+
+#endif // SYMBOL_CACHE_SIZE
+
 inline void OutputEntryImpl(std::ostream& stream, void const* address, bool tiny)
 {
+#if SYMBOL_CACHE_SIZE
+    SymbolCache& cache = SymbolCacheFor(tiny);
+    std::string  text;
+    if (!cache.Find(address, text))
+    {
+        // symbolize outside of the cache lock, a racing thread at most does it twice
+        std::ostringstream entry;
+        tiny ? OutputEntryTiny(entry, address) : OutputEntryWide(entry, address);
+        text = entry.str();
+        cache.Insert(address, text);
+    }
+    stream << text;
+#else  // SYMBOL_CACHE_SIZE
     tiny ? OutputEntryTiny(stream, address) : OutputEntryWide(stream, address);
+#endif // SYMBOL_CACHE_SIZE
+}
+
+// Drops symbols cached for modules that may have been unloaded or replaced
+void SyncModules()
+{
+    unsigned long long generation = ModuleGeneration();
+    if (g_moduleGeneration.exchange(generation) != generation)
+    {
+#if SYMBOL_CACHE_SIZE
+        SymbolCacheFor(false).Clear();
+        SymbolCacheFor(true).Clear();
+#endif // SYMBOL_CACHE_SIZE
+    }
 }
 
 struct ImplementationBase
 {
-    void*       Stack[Callstack::MaxStackLimit];
-    std::size_t FilledStackSize;
+    void*             Stack[Callstack::MaxStackLimit];
+    std::size_t       FilledStackSize;
+    ModuleSnapshotPtr Modules; // null unless SnapshotModules was called
 
     ImplementationBase()
         : Stack()
         , FilledStackSize()
+        , Modules()
     {
     }
 
     ImplementationBase(ImplementationBase const& other)
         : Stack()
         , FilledStackSize(other.FilledStackSize)
+        , Modules(other.Modules)
     {
         std::memcpy(Stack, other.Stack, FilledStackSize * sizeof(void*));
     }
@@ -693,6 +1067,15 @@ struct Callstack::Implementation : public ImplementationBase
 #endif // USE_HASH
     }
 
+    Implementation(void* const* addresses, std::size_t size)
+    {
+        FilledStackSize = std::min<std::size_t>(size, MaxStackLimit);
+        std::memcpy(Stack, addresses, FilledStackSize * sizeof(void*));
+#if USE_HASH
+        Hash = static_cast<HashType>(Callstack::HashFrames(Stack, FilledStackSize));
+#endif // USE_HASH
+    }
+
     Implementation(Implementation const& other)
         : ImplementationBase(other)
     {
@@ -729,6 +1112,11 @@ Callstack::Callstack(std::size_t ignore, std::size_t limit)
 {
 }
 
+Callstack::Callstack(void* const* addresses, std::size_t size)
+    : mImpl(new Implementation(addresses, size))
+{
+}
+
 Callstack::Callstack(Callstack const& other)
     : mImpl(new Implementation(*other.mImpl))
 {
@@ -776,6 +1164,166 @@ void const* Callstack::operator[](std::size_t index) const
     return At(index);
 }
 
+std::size_t Callstack::Hash() const
+{
+#if USE_HASH
+    return static_cast<std::size_t>(mImpl->Hash);
+#else  // USE_HASH
+    return HashFrames(mImpl->Stack, mImpl->FilledStackSize);
+#endif // USE_HASH
+}
+
+void Callstack::SnapshotModules()
+{
+    if (mImpl->Modules == nullptr)
+    {
+        mImpl->Modules = CurrentModuleSnapshot();
+    }
+}
+
+unsigned long long Callstack::CurrentModules()
+{
+    SyncModules();
+    return g_moduleGeneration.load(std::memory_order_relaxed);
+}
+
+std::size_t Callstack::Capture(void** addresses, std::size_t ignore, std::size_t limit)
+{
+    return Backtrace(++ignore, addresses, limit);
+}
+
+std::size_t Callstack::HashFrames(void* const* addresses, std::size_t size)
+{
+    std::uint64_t hash = 0xcbf29ce484222325ull ^ size;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= reinterpret_cast<std::uintptr_t>(addresses[i]);
+        hash *= 0x100000001b3ull;
+        hash ^= hash >> 29;
+    }
+    return static_cast<std::size_t>(hash);
+}
+
+struct CallstackSites::Implementation
+{
+    // Return addresses of calls made by a function, in (Start, End]
+    struct Range
+    {
+        std::uintptr_t Start;
+        std::uintptr_t End;
+    };
+
+    // how far the end of a function is looked for
+    static std::uintptr_t const MaxFunctionSize = 1024 * 1024;
+
+    // start of the function holding an address, or null if it is unknown
+    static void const* FunctionOf(void const* address)
+    {
+#if HAS_DLFCN
+        Dl_info info;
+        info.dli_saddr = nullptr;
+        if (dladdr(address, &info) != 0)
+        {
+            return info.dli_saddr;
+        }
+#endif // HAS_DLFCN
+        return nullptr;
+    }
+
+    // the function holding an address, bounded by the size of its symbol. Without dladdr1, the
+    // addresses dladdr attributes to the function, found by bisection: this relies on the loader
+    // attributing only the addresses within the size of a symbol to it, as bionic does
+    static bool Resolve(void const* function, Range& range)
+    {
+#if HAS_DLADDR1
+        Dl_info info;
+        void*   entry  = nullptr;
+        info.dli_saddr = nullptr;
+        if (dladdr1(function, &info, &entry, RTLD_DL_SYMENT) == 0 || entry == nullptr)
+        {
+            return false;
+        }
+        ElfW(Sym) const* symbol = static_cast<ElfW(Sym) const*>(entry);
+        if (info.dli_saddr == nullptr || symbol->st_size == 0)
+        {
+            // a symbol without size would take in the functions following it
+            return false;
+        }
+        range.Start = reinterpret_cast<std::uintptr_t>(info.dli_saddr);
+        range.End   = range.Start + symbol->st_size;
+        return true;
+#else  // HAS_DLADDR1
+        void const* start = FunctionOf(function);
+        if (start == nullptr)
+        {
+            return false;
+        }
+        std::uintptr_t first = reinterpret_cast<std::uintptr_t>(start);
+        std::uintptr_t last  = first; // attributed to the function
+        std::uintptr_t after = first + MaxFunctionSize; // assumed not to be
+        while (after - last > 1)
+        {
+            std::uintptr_t middle = last + (after - last) / 2;
+            (FunctionOf(reinterpret_cast<void const*>(middle)) == start ? last : after) = middle;
+        }
+        range.Start = first;
+        range.End   = last + 1;
+        return true;
+#endif // HAS_DLADDR1
+    }
+
+    // Ranges [0, Count) are complete, Add fills them under AddMutex before publishing them
+    Range                    Ranges[MaxSites];
+    std::atomic<std::size_t> Count;
+    std::mutex               AddMutex;
+};
+
+CallstackSites::CallstackSites()
+    : mImpl(new Implementation())
+{
+    mImpl->Count.store(0, std::memory_order_relaxed);
+}
+
+CallstackSites::~CallstackSites()
+{
+}
+
+bool CallstackSites::Add(void const* function)
+{
+    Implementation::Range range;
+    if (!Implementation::Resolve(function, range))
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mImpl->AddMutex);
+    std::size_t                 count = mImpl->Count.load(std::memory_order_relaxed);
+    if (count == MaxSites)
+    {
+        return false;
+    }
+    mImpl->Ranges[count] = range;
+    mImpl->Count.store(count + 1, std::memory_order_release);
+    return true;
+}
+
+bool CallstackSites::Matches(void* const* frames, std::size_t size) const
+{
+    std::size_t const count = mImpl->Count.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        std::uintptr_t address = reinterpret_cast<std::uintptr_t>(frames[i]);
+        for (std::size_t site = 0; site < count; ++site)
+        {
+            Implementation::Range const& range = mImpl->Ranges[site];
+            if (address > range.Start && address <= range.End)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 CallstackFormat::CallstackFormat(Callstack const& callstack, bool tiny, std::size_t from,
                                  std::size_t count)
     : m_callstack(callstack)
@@ -789,7 +1337,20 @@ void CallstackFormat::OutputEntryImpl(std::size_t index, std::ostream& stream) c
 {
     assert(index >= m_from);
     assert(index < m_end);
-    ::OutputEntryImpl(stream, m_callstack[index], m_tiny);
+    void const*                   address  = m_callstack[index];
+    ModuleSnapshotPtr const&      modules  = m_callstack.mImpl->Modules;
+    ModuleSnapshot::Module const* captured = (modules != nullptr) ? modules->Find(address) : nullptr;
+    if (captured != nullptr)
+    {
+        ModuleSnapshotPtr             current = CurrentModuleSnapshot();
+        ModuleSnapshot::Module const* now     = (current != nullptr) ? current->Find(address) : nullptr;
+        if (now == nullptr || now->Base != captured->Base || now->Path != captured->Path)
+        {
+            OutputEntryUnloaded(stream, address, *captured, m_tiny);
+            return;
+        }
+    }
+    ::OutputEntryImpl(stream, address, m_tiny);
 }
 
 CallstackFormat::operator std::string() const
@@ -801,6 +1362,7 @@ CallstackFormat::operator std::string() const
 
 void CallstackFormat::Output(std::ostream& stream) const
 {
+    SyncModules();
     for (std::size_t i = m_from; i < m_end; ++i)
     {
         OutputEntry(i, stream);
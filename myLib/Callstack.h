@@ -1,11 +1,20 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <iosfwd>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <utility>
 
+// Frames kept by Callstack, deeper stacks are truncated.
+// InlineCallstack takes its own limit as template parameter.
+#ifndef CALLSTACK_MAX_STACK_LIMIT
+#   define CALLSTACK_MAX_STACK_LIMIT 32
+#endif // CALLSTACK_MAX_STACK_LIMIT
+
 namespace Navionics
 {
 class Callstack
@@ -13,11 +22,13 @@ class Callstack
 public:
     enum
     {
-        MaxStackLimit = 32
+        MaxStackLimit = CALLSTACK_MAX_STACK_LIMIT
     };
 
 public:
     explicit Callstack(std::size_t ignore = 0, std::size_t limit = MaxStackLimit);
+    // Wraps frames captured earlier with Capture, at most MaxStackLimit of them are kept
+    Callstack(void* const* addresses, std::size_t size);
     Callstack(const Callstack& other);
     ~Callstack();
 
@@ -29,11 +40,132 @@ public:
     bool operator<(const Callstack& other) const;
     void const* operator[](std::size_t index) const;
 
+    // Hash of the frames, equal callstacks have equal hashes
+    std::size_t Hash() const;
+
+    // Keeps the list of the modules loaded now with the frames, for stacks formatted later.
+    // Frames of a module unloaded or replaced meanwhile are then shown as module + offset instead of
+    // being resolved against what is mapped there now. The list is shared and only rebuilt once a
+    // module was loaded or unloaded. Does nothing if taken already; not for signal handlers.
+    void SnapshotModules();
+    // Changes whenever a module is loaded or unloaded
+    static unsigned long long CurrentModules();
+
+    // Captures raw frame addresses into caller provided storage.
+    // Does not allocate with the unwind backend, so it may be used from a signal handler.
+    static std::size_t Capture(void** addresses, std::size_t ignore, std::size_t limit);
+    // Hash of raw frames, the one Hash() uses unless the backend provides its own
+    static std::size_t HashFrames(void* const* addresses, std::size_t size);
+
 private:
+    friend class CallstackFormat;
+
     struct Implementation;
     std::unique_ptr<Implementation> mImpl;
 };
 
+// Functions whose presence near the top of a stack makes an adaptive capture walk deeper
+class CallstackSites
+{
+public:
+    enum
+    {
+        MaxSites = 64
+    };
+
+public:
+    CallstackSites();
+    ~CallstackSites();
+
+    CallstackSites(const CallstackSites&) = delete;
+    CallstackSites& operator=(const CallstackSites&) = delete;
+
+    // function may be any address inside the function, usually the function itself.
+    // Resolved once here into the address range of the function with dladdr, bounded by the size
+    // of its symbol, so the function has to be in the dynamic symbol table: exported from a shared
+    // library, or from an executable linked with -rdynamic. Returns false if it is not, if its
+    // symbol has no size, or if MaxSites were added.
+    bool Add(void const* function);
+    // True if one of the frames lies in an added function.
+    // Lock free and allocation free, so it may run concurrently with Add or in a signal handler.
+    bool Matches(void* const* frames, std::size_t size) const;
+
+private:
+    struct Implementation;
+    std::unique_ptr<Implementation> mImpl;
+};
+
+#if defined(_MSC_VER)
+#   define CALLSTACK_NOINLINE __declspec(noinline)
+#else
+#   define CALLSTACK_NOINLINE __attribute__((noinline))
+#endif
+
+// Callstack keeping its frames inline instead of behind a heap allocated implementation.
+// Capturing (with the unwind backend) and copying never touch the heap and the class is
+// trivially copyable, so it can be captured on hot paths, in allocator hooks or in signal
+// handlers. Format it through ToCallstack(), e.g. Wide(stack.ToCallstack()).
+template <std::size_t Limit = Callstack::MaxStackLimit>
+class InlineCallstack
+{
+public:
+    enum
+    {
+        MaxStackLimit = Limit
+    };
+
+public:
+    CALLSTACK_NOINLINE explicit InlineCallstack(std::size_t ignore = 0, std::size_t limit = Limit)
+        : m_size(Callstack::Capture(m_frames, ++ignore, (limit < Limit) ? limit : Limit))
+    {
+    }
+
+    // Adaptive capture: walks only `shallow` frames, and again up to Limit frames if one of
+    // them lies in a function of sites. Keeps the common capture cheap while the stacks
+    // going through the interesting functions are kept whole. Matching the sites does not
+    // lock nor allocate either, but only the functions sites.Add() could resolve are matched.
+    CALLSTACK_NOINLINE InlineCallstack(const CallstackSites& sites, std::size_t shallow,
+                                       std::size_t ignore = 0)
+        : m_size(Callstack::Capture(m_frames, ++ignore, (shallow < Limit) ? shallow : Limit))
+    {
+        // a capture shorter than requested already holds the whole stack
+        if (m_size == shallow && shallow < Limit && sites.Matches(m_frames, m_size))
+        {
+            m_size = Callstack::Capture(m_frames, ignore, Limit);
+        }
+    }
+
+    void const* At(std::size_t index) const { return (index < m_size) ? m_frames[index] : nullptr; }
+    std::size_t Size() const { return m_size; }
+    void* const* Frames() const { return m_frames; }
+
+    bool operator==(const InlineCallstack& other) const
+    {
+        return m_size == other.m_size &&
+               std::equal(m_frames, m_frames + m_size, other.m_frames);
+    }
+    bool operator<(const InlineCallstack& other) const
+    {
+        return m_size < other.m_size ||
+               (m_size == other.m_size &&
+                std::lexicographical_compare(m_frames, m_frames + m_size, other.m_frames,
+                                             other.m_frames + m_size));
+    }
+    void const* operator[](std::size_t index) const { return At(index); }
+
+    std::size_t Hash() const { return Callstack::HashFrames(m_frames, m_size); }
+
+    // Allocates, meant for the cold formatting path
+    Callstack ToCallstack() const { return Callstack(m_frames, m_size); }
+
+private:
+    std::size_t m_size;
+    void*       m_frames[Limit];
+};
+
+static_assert(std::is_trivially_copyable<InlineCallstack<>>::value,
+              "InlineCallstack must copy without touching the heap");
+
 class CallstackFormat
 {
 public:
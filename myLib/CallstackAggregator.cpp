@@ -0,0 +1,153 @@
+#include "CallstackAggregator.h"
+
+#include <utility>
+#include <vector>
+
+using namespace Navionics;
+
+CallstackAggregator::CallstackAggregator(std::shared_ptr<spdlog::logger> logger,
+                                         std::chrono::milliseconds flushInterval,
+                                         spdlog::level::level_enum level, std::size_t capacity)
+    : m_logger(std::move(logger))
+    , m_flushInterval(flushInterval)
+    , m_level(level)
+    , m_symbolizer([this](std::string const& text) { Log(text); })
+    , m_shardCapacity((capacity + Shards - 1) / Shards)
+    , m_shards()
+    , m_flushMutex()
+    , m_nextId(0)
+    , m_stopMutex()
+    , m_wakeup()
+    , m_stop(false)
+    , m_thread()
+{
+    if (m_flushInterval != std::chrono::milliseconds::zero())
+    {
+        m_thread = std::thread(&CallstackAggregator::Run, this);
+    }
+}
+
+CallstackAggregator::~CallstackAggregator()
+{
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_stopMutex);
+            m_stop = true;
+        }
+        m_wakeup.notify_one();
+        m_thread.join();
+    }
+    try
+    {
+        Flush();
+    }
+    catch (...) // don't crash in destructor
+    {
+    }
+}
+
+void CallstackAggregator::Add(Callstack const& callstack, char const* message)
+{
+    {
+        Shard&                      shard = m_shards[callstack.Hash() % Shards];
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        Entries::iterator           it = shard.Stacks.find(callstack);
+        if (it != shard.Stacks.end())
+        {
+            ++it->second.Count;
+            it->second.Seen = true;
+            return;
+        }
+        if (shard.Stacks.size() >= m_shardCapacity)
+        {
+            ++shard.Overflow;
+            return;
+        }
+        std::size_t id = ++m_nextId;
+        shard.Stacks.insert(std::make_pair(callstack, Entry{id, 0, true}));
+        // first occurrence: logged now, symbolized off this thread. Posted under the shard lock
+        // so the count lines of a concurrent flush are queued after it
+        m_symbolizer.Post(std::string(message) + " (callstack #" + std::to_string(id) + ")",
+                          callstack);
+    }
+}
+
+void CallstackAggregator::Flush()
+{
+    struct Report
+    {
+        std::size_t Id;
+        std::size_t Count;
+    };
+
+    // keeps the counts of concurrent flushes in order
+    std::lock_guard<std::mutex> flushLock(m_flushMutex);
+    for (Shard& shard : m_shards)
+    {
+        std::vector<Report> reports;
+        std::size_t         overflow = 0;
+        {
+            std::lock_guard<std::mutex> lock(shard.Mutex);
+            for (Entries::iterator it = shard.Stacks.begin(); it != shard.Stacks.end();)
+            {
+                Entry& entry = it->second;
+                if (!entry.Seen)
+                {
+                    // not seen during a whole flush interval: makes room for new callstacks
+                    it = shard.Stacks.erase(it);
+                    continue;
+                }
+                if (entry.Count != 0)
+                {
+                    reports.push_back(Report{entry.Id, entry.Count});
+                }
+                entry.Count = 0;
+                entry.Seen  = false;
+                ++it;
+            }
+            std::swap(overflow, shard.Overflow);
+        }
+
+        if (!m_logger->should_log(m_level))
+        {
+            continue;
+        }
+        // outside of the shard lock, and after the first occurrences still being symbolized
+        for (Report const& report : reports)
+        {
+            m_symbolizer.Post("callstack #" + std::to_string(report.Id) + " seen " +
+                              std::to_string(report.Count) + " more times");
+        }
+        if (overflow != 0)
+        {
+            m_logger->force_log(m_level, "{} callstacks not aggregated, the table is full",
+                                overflow);
+        }
+    }
+}
+
+void CallstackAggregator::Run()
+{
+    std::unique_lock<std::mutex> lock(m_stopMutex);
+    while (!m_wakeup.wait_for(lock, m_flushInterval, [this]() { return m_stop; }))
+    {
+        lock.unlock();
+        try
+        {
+            Flush();
+        }
+        catch (...) // keep flushing, a failing sink must not end the aggregation
+        {
+        }
+        lock.lock();
+    }
+}
+
+void CallstackAggregator::Log(std::string const& text)
+{
+    if (m_logger->should_log(m_level))
+    {
+        m_logger->force_log(m_level, "{}", text);
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Callstack.h"
+#include "DeferredSymbolizer.h"
+
+#include "spdlog/logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace Navionics
+{
+// Counts occurrences of distinct callstacks instead of logging each of them.
+// The first occurrence of a callstack is logged at once with its symbolized callstack,
+// symbolization happening on the thread of a DeferredSymbolizer. Every flush then logs one
+// line with the count of each callstack seen again since the previous flush, through the same
+// thread so it follows the first occurrence. Callstacks not seen during a whole flush interval
+// are forgotten, so the table holds the recent ones; one coming back later is logged again as
+// a first occurrence.
+class CallstackAggregator
+{
+public:
+    // flushInterval of zero disables the periodic flush, Flush() has to be called then
+    CallstackAggregator(std::shared_ptr<spdlog::logger> logger,
+                        std::chrono::milliseconds flushInterval,
+                        spdlog::level::level_enum level = spdlog::level::warn,
+                        std::size_t capacity = 4096);
+    // flushes what is pending
+    ~CallstackAggregator();
+
+    CallstackAggregator(const CallstackAggregator&) = delete;
+    CallstackAggregator& operator=(const CallstackAggregator&) = delete;
+
+    // message is used only for the first occurrence of the callstack
+    void Add(const Callstack& callstack, const char* message = "");
+    void Flush();
+
+private:
+    enum
+    {
+        Shards = 16
+    };
+
+    struct Entry
+    {
+        std::size_t Id;
+        std::size_t Count; // occurrences since the previous flush, the first one excluded
+        bool        Seen; // added since the previous flush, the first occurrence included
+    };
+
+    struct Hasher
+    {
+        std::size_t operator()(const Callstack& callstack) const { return callstack.Hash(); }
+    };
+
+    using Entries = std::unordered_map<Callstack, Entry, Hasher>;
+
+    struct alignas(64) Shard
+    {
+        std::mutex  Mutex;
+        Entries     Stacks;
+        std::size_t Overflow = 0;
+    };
+
+    void Run();
+    void Log(const std::string& text);
+
+private:
+    std::shared_ptr<spdlog::logger> const m_logger;
+    std::chrono::milliseconds const       m_flushInterval;
+    spdlog::level::level_enum const       m_level;
+    DeferredSymbolizer                    m_symbolizer; // first occurrences, logs through m_logger
+    std::size_t const                     m_shardCapacity;
+    Shard                                 m_shards[Shards];
+    std::mutex                            m_flushMutex;
+    std::atomic<std::size_t>              m_nextId;
+    std::mutex                            m_stopMutex;
+    std::condition_variable               m_wakeup;
+    bool                                  m_stop;
+    std::thread                           m_thread;
+};
+}
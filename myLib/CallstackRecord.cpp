@@ -0,0 +1,408 @@
+#include "CallstackRecord.h"
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+
+#ifndef HAS_DLFCN
+#   if defined(_WIN32)
+#       define HAS_DLFCN 0
+#   else
+#       define HAS_DLFCN 1
+#   endif
+#endif // HAS_DLFCN
+
+#ifndef HAS_ELF
+#   if defined(__linux__) || defined(ANDROID)
+#       define HAS_ELF 1
+#   else
+#       define HAS_ELF 0
+#   endif
+#endif // HAS_ELF
+
+#if HAS_DLFCN
+#   include <dlfcn.h>
+#endif // HAS_DLFCN
+
+#if HAS_ELF
+#   include <elf.h>
+#   include <link.h>
+#endif // HAS_ELF
+
+using namespace Navionics;
+
+namespace
+{
+
+void PutVarint(std::string& out, std::uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool GetVarint(char const*& data, char const* end, std::uint64_t& value)
+{
+    value = 0;
+    for (unsigned shift = 0; data != end && shift < 64; shift += 7)
+    {
+        std::uint64_t byte = static_cast<unsigned char>(*data++);
+        value |= (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PutString(std::string& out, std::string const& value)
+{
+    PutVarint(out, value.size());
+    out.append(value);
+}
+
+bool GetString(char const*& data, char const* end, std::string& value)
+{
+    std::uint64_t size = 0;
+    if (!GetVarint(data, end, size) || size > static_cast<std::uint64_t>(end - data))
+    {
+        return false;
+    }
+    value.assign(data, static_cast<std::size_t>(size));
+    data += size;
+    return true;
+}
+
+inline std::uint64_t ZigZag(std::int64_t value)
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t UnZigZag(std::uint64_t value)
+{
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+char const Base64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+void Base64Encode(std::string const& in, std::ostream& out)
+{
+    std::size_t i = 0;
+    for (; i + 2 < in.size(); i += 3)
+    {
+        unsigned value = (static_cast<unsigned char>(in[i]) << 16) |
+                         (static_cast<unsigned char>(in[i + 1]) << 8) |
+                         static_cast<unsigned char>(in[i + 2]);
+        out << Base64Chars[(value >> 18) & 63] << Base64Chars[(value >> 12) & 63]
+            << Base64Chars[(value >> 6) & 63] << Base64Chars[value & 63];
+    }
+    if (i < in.size())
+    {
+        unsigned value = static_cast<unsigned char>(in[i]) << 16;
+        if (i + 1 < in.size())
+        {
+            value |= static_cast<unsigned char>(in[i + 1]) << 8;
+        }
+        out << Base64Chars[(value >> 18) & 63] << Base64Chars[(value >> 12) & 63];
+        out << ((i + 1 < in.size()) ? Base64Chars[(value >> 6) & 63] : '=') << '=';
+    }
+}
+
+bool Base64Decode(std::string const& in, std::string& out)
+{
+    unsigned value = 0;
+    int      bits  = 0;
+    for (char c : in)
+    {
+        char const* found = (c != '\0') ? std::strchr(Base64Chars, c) : nullptr;
+        if (found == nullptr)
+        {
+            if (c == '=')
+            {
+                break;
+            }
+            return false;
+        }
+        value = (value << 6) | static_cast<unsigned>(found - Base64Chars);
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            out.push_back(static_cast<char>((value >> bits) & 0xff));
+        }
+    }
+    return true;
+}
+
+inline char const* FileNameFromPath(char const* path)
+{
+    char const* file = path;
+    for (char const* p = file; *p != '\0'; ++p)
+    {
+        if ((*p == '\\' || *p == '/') && (*(p + 1) != '\0'))
+        {
+            file = p + 1;
+        }
+    }
+    return file;
+}
+
+struct ModuleInfo
+{
+    std::string    BuildId;
+    std::string    Name;
+    std::uintptr_t Bias; // run-time address minus link-time address
+};
+
+#if HAS_ELF
+
+// Reads the build-id and load bias from the ELF headers mapped at the module base
+void ReadElf(void const* base, ModuleInfo& info)
+{
+    char const*        image  = static_cast<char const*>(base);
+    ElfW(Ehdr) const*  header = reinterpret_cast<ElfW(Ehdr) const*>(image);
+    if (std::memcmp(header->e_ident, ELFMAG, SELFMAG) != 0)
+    {
+        return;
+    }
+    ElfW(Phdr) const* phdrs = reinterpret_cast<ElfW(Phdr) const*>(image + header->e_phoff);
+
+    for (ElfW(Half) i = 0; i < header->e_phnum; ++i)
+    {
+        // the segment mapping the start of the file is the one mapped at the base
+        if (phdrs[i].p_type == PT_LOAD && phdrs[i].p_offset == 0)
+        {
+            info.Bias = reinterpret_cast<std::uintptr_t>(base) - phdrs[i].p_vaddr;
+            break;
+        }
+    }
+
+    for (ElfW(Half) i = 0; i < header->e_phnum; ++i)
+    {
+        if (phdrs[i].p_type != PT_NOTE)
+        {
+            continue;
+        }
+        char const* note = reinterpret_cast<char const*>(info.Bias + phdrs[i].p_vaddr);
+        char const* end  = note + phdrs[i].p_memsz;
+        while (note + sizeof(ElfW(Nhdr)) <= end)
+        {
+            ElfW(Nhdr) const* nhdr = reinterpret_cast<ElfW(Nhdr) const*>(note);
+            char const*       name = note + sizeof(ElfW(Nhdr));
+            char const*       desc = name + ((nhdr->n_namesz + 3) & ~3u);
+            if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 &&
+                std::memcmp(name, "GNU", 4) == 0 && desc + nhdr->n_descsz <= end)
+            {
+                info.BuildId.assign(desc, nhdr->n_descsz);
+                return;
+            }
+            note = desc + ((nhdr->n_descsz + 3) & ~3u);
+        }
+    }
+}
+
+#endif // HAS_ELF
+
+// Module lookups per module base, dropped whenever modules are loaded or unloaded
+class ModuleTable
+{
+public:
+    // generation is Callstack::CurrentModules(), taken once by the caller for all the frames of a stack
+    bool Find(void const* address, unsigned long long generation, void const*& base, ModuleInfo& info)
+    {
+#if HAS_DLFCN
+        Dl_info dlInfo;
+        dlInfo.dli_fname = nullptr;
+        dlInfo.dli_fbase = nullptr;
+        if (dladdr(address, &dlInfo) == 0 || dlInfo.dli_fbase == nullptr)
+        {
+            return false;
+        }
+        base = dlInfo.dli_fbase;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (generation != m_generation)
+        {
+            m_modules.clear();
+            m_generation = generation;
+        }
+
+        Modules::const_iterator it = m_modules.find(base);
+        if (it == m_modules.end())
+        {
+            ModuleInfo module;
+            module.Name = (dlInfo.dli_fname != nullptr) ? FileNameFromPath(dlInfo.dli_fname) : "";
+            module.Bias = reinterpret_cast<std::uintptr_t>(base);
+#if HAS_ELF
+            ReadElf(base, module);
+#endif // HAS_ELF
+            it = m_modules.insert(std::make_pair(base, module)).first;
+        }
+        info = it->second;
+        return true;
+#else  // HAS_DLFCN
+        (void) address;
+        (void) generation;
+        (void) base;
+        (void) info;
+        return false;
+#endif // HAS_DLFCN
+    }
+
+private:
+    using Modules = std::map<void const*, ModuleInfo>;
+
+    std::mutex         m_mutex;
+    Modules            m_modules;
+    unsigned long long m_generation = 0;
+};
+
+} // namespace
+
+CallstackRecord CallstackRecord::From(Callstack const& callstack)
+{
+    static ModuleTable table;
+
+    CallstackRecord                    record;
+    std::map<void const*, std::size_t> indices;
+    std::vector<std::size_t>           unknown;
+    unsigned long long const           generation = Callstack::CurrentModules();
+
+    for (std::size_t i = 0; i < callstack.Size(); ++i)
+    {
+        void const* address = callstack[i];
+        void const* base    = nullptr;
+        ModuleInfo  info;
+        Frame       frame;
+        if (table.Find(address, generation, base, info))
+        {
+            std::map<void const*, std::size_t>::const_iterator it = indices.find(base);
+            if (it == indices.end())
+            {
+                it = indices.insert(std::make_pair(base, record.Modules.size())).first;
+                record.Modules.push_back(Module{info.BuildId, info.Name});
+            }
+            frame.Module = it->second;
+            frame.Offset = reinterpret_cast<std::uintptr_t>(address) - info.Bias;
+        }
+        else
+        {
+            // patched to the final module count once all modules are known
+            frame.Module = 0;
+            frame.Offset = reinterpret_cast<std::uintptr_t>(address);
+            unknown.push_back(record.Frames.size());
+        }
+        record.Frames.push_back(frame);
+    }
+    for (std::size_t index : unknown)
+    {
+        record.Frames[index].Module = record.Modules.size();
+    }
+    return record;
+}
+
+void CallstackRecord::Encode(std::string& out) const
+{
+    PutVarint(out, Version);
+    PutVarint(out, Modules.size());
+    for (Module const& module : Modules)
+    {
+        PutString(out, module.BuildId);
+        PutString(out, module.Name);
+    }
+    PutVarint(out, Frames.size());
+    std::uint64_t previous = 0;
+    for (Frame const& frame : Frames)
+    {
+        PutVarint(out, frame.Module);
+        PutVarint(out, ZigZag(static_cast<std::int64_t>(frame.Offset - previous)));
+        previous = frame.Offset;
+    }
+}
+
+std::size_t CallstackRecord::Decode(char const* data, std::size_t size)
+{
+    char const* const begin = data;
+    char const* const end   = data + size;
+
+    std::uint64_t version = 0;
+    std::uint64_t count   = 0;
+    if (!GetVarint(data, end, version) || version != Version || !GetVarint(data, end, count) ||
+        count > size)
+    {
+        return 0;
+    }
+    Modules.assign(static_cast<std::size_t>(count), Module());
+    for (Module& module : Modules)
+    {
+        if (!GetString(data, end, module.BuildId) || !GetString(data, end, module.Name))
+        {
+            return 0;
+        }
+    }
+
+    if (!GetVarint(data, end, count) || count > size)
+    {
+        return 0;
+    }
+    Frames.assign(static_cast<std::size_t>(count), Frame());
+    std::uint64_t previous = 0;
+    for (Frame& frame : Frames)
+    {
+        std::uint64_t module = 0;
+        std::uint64_t delta  = 0;
+        if (!GetVarint(data, end, module) || module > Modules.size() ||
+            !GetVarint(data, end, delta))
+        {
+            return 0;
+        }
+        frame.Module = static_cast<std::size_t>(module);
+        frame.Offset = previous + static_cast<std::uint64_t>(UnZigZag(delta));
+        previous     = frame.Offset;
+    }
+    return static_cast<std::size_t>(data - begin);
+}
+
+CallstackBinary::CallstackBinary(Callstack const& callstack)
+    : m_callstack(callstack)
+{
+}
+
+CallstackBinary::operator std::string() const
+{
+    std::stringstream stream;
+    stream << *this;
+    return stream.str();
+}
+
+void CallstackBinary::Output(std::ostream& stream) const
+{
+    std::string encoded;
+    CallstackRecord::From(m_callstack).Encode(encoded);
+    stream << Marker();
+    Base64Encode(encoded, stream);
+}
+
+bool CallstackBinary::Parse(std::string const& text, CallstackRecord& record)
+{
+    std::string encoded;
+    return Base64Decode(text, encoded) && !encoded.empty() &&
+           record.Decode(encoded.data(), encoded.size()) == encoded.size();
+}
+
+CallstackBinary Navionics::Binary(Callstack const& callstack)
+{
+    return CallstackBinary(callstack);
+}
+
+std::ostream& operator<<(std::ostream& stream, CallstackBinary const& binary)
+{
+    binary.Output(stream);
+    return stream;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Callstack.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace Navionics
+{
+// Compact binary form of a callstack: frames are stored as module relative offsets
+// (varint, delta encoded) next to the build-id and file name of their modules,
+// so they can be symbolized offline against unstripped binaries.
+//
+// Layout (all integers are LEB128 varints):
+//   version
+//   module count, per module: build-id size, build-id, name size, name
+//   frame count, per frame: module index, zigzag delta of the offset to the previous frame
+// A module index equal to the module count marks a frame outside any known module,
+// its offset is then the absolute address.
+struct CallstackRecord
+{
+    enum
+    {
+        Version = 1
+    };
+
+    struct Module
+    {
+        std::string BuildId; // raw bytes, empty if unknown
+        std::string Name;
+    };
+
+    struct Frame
+    {
+        std::size_t   Module;
+        std::uint64_t Offset;
+    };
+
+    std::vector<Module> Modules;
+    std::vector<Frame>  Frames;
+
+    static CallstackRecord From(const Callstack& callstack);
+
+    void Encode(std::string& out) const;
+    // Returns the number of bytes consumed, 0 if data does not hold a valid record.
+    std::size_t Decode(const char* data, std::size_t size);
+};
+
+// Text friendly form for log sinks: "@cs:" followed by the base64 encoded record
+class CallstackBinary
+{
+public:
+    static const char* Marker() { return "@cs:"; }
+
+    explicit CallstackBinary(const Callstack& callstack);
+    operator std::string() const;
+
+    void Output(std::ostream& stream) const;
+
+    // Decodes the base64 text following the marker, returns false if it is not a record.
+    static bool Parse(const std::string& text, CallstackRecord& record);
+
+private:
+    Callstack const& m_callstack;
+};
+
+CallstackBinary Binary(const Callstack& callstack);
+}
+
+std::ostream& operator<<(std::ostream& stream, const Navionics::CallstackBinary& binary);
@@ -0,0 +1,162 @@
+#include "CrashDump.h"
+#include "Callstack.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace Navionics;
+
+namespace
+{
+int   g_fd = -1;
+// preallocated, the crash path must not touch the heap
+void* g_frames[Callstack::MaxStackLimit];
+char  g_buffer[512];
+// owned by the thread writing a dump, threads crashing at the same time skip theirs
+std::atomic_flag g_writing = ATOMIC_FLAG_INIT;
+
+void WriteAll(int fd, char const* data, std::size_t size)
+{
+    while (size != 0)
+    {
+        ssize_t written = ::write(fd, data, size);
+        if (written <= 0)
+        {
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
+
+inline void WriteString(int fd, char const* str)
+{
+    WriteAll(fd, str, std::strlen(str));
+}
+
+// snprintf is not async-signal-safe, so numbers are formatted by hand
+char* FormatHex(char* out, std::uintptr_t value)
+{
+    static char const digits[] = "0123456789abcdef";
+    for (int shift = sizeof(value) * 8 - 4; shift >= 0; shift -= 4)
+    {
+        *out++ = digits[(value >> shift) & 0xf];
+    }
+    return out;
+}
+
+char* FormatDecimal(char* out, unsigned value)
+{
+    char  reversed[16];
+    char* p = reversed;
+    do
+    {
+        *p++ = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (p != reversed)
+    {
+        *out++ = *--p;
+    }
+    return out;
+}
+
+// module bases are needed to symbolize the addresses offline
+void CopyMaps(int fd)
+{
+    int maps = ::open("/proc/self/maps", O_RDONLY);
+    if (maps < 0)
+    {
+        return;
+    }
+    WriteString(fd, "*** maps\n");
+    ssize_t count = 0;
+    while ((count = ::read(maps, g_buffer, sizeof(g_buffer))) != 0)
+    {
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        WriteAll(fd, g_buffer, static_cast<std::size_t>(count));
+    }
+    ::close(maps);
+}
+
+} // namespace
+
+bool CrashDump::Open(char const* path)
+{
+    Close();
+    g_fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    // the first unwind loads the unwinder and its tables, which allocates and locks: not in the signal handler
+    Callstack::Capture(g_frames, 0, Callstack::MaxStackLimit);
+    return g_fd >= 0;
+}
+
+void CrashDump::Close()
+{
+    if (g_fd >= 0)
+    {
+        ::close(g_fd);
+        g_fd = -1;
+    }
+}
+
+void CrashDump::Write(int signal, std::size_t ignore)
+{
+    int fd = g_fd;
+    if (fd < 0 || g_writing.test_and_set(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    std::size_t size = Callstack::Capture(g_frames, ++ignore, Callstack::MaxStackLimit);
+
+    char  line[64];
+    char* end = line;
+    std::memcpy(end, "*** signal ", 11);
+    end = FormatDecimal(end + 11, static_cast<unsigned>(signal));
+    *end++ = '\n';
+    WriteAll(fd, line, end - line);
+
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        end    = line;
+        *end++ = '#';
+        if (i < 10)
+        {
+            *end++ = '0';
+        }
+        end    = FormatDecimal(end, static_cast<unsigned>(i));
+        *end++ = ' ';
+        end    = FormatHex(end, reinterpret_cast<std::uintptr_t>(g_frames[i]));
+        *end++ = '\n';
+        WriteAll(fd, line, end - line);
+    }
+
+    CopyMaps(fd);
+    WriteString(fd, "*** end\n");
+    ::fsync(fd);
+    g_writing.clear(std::memory_order_release);
+}
+
+std::string CrashDump::Read(char const* path)
+{
+    std::ifstream stream(path);
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Navionics
+{
+// Crash reporting path that is safe to use from a signal handler.
+// The dump file is opened up front; on a crash only raw frame addresses and a copy of
+// /proc/self/maps are written to it with write(2), symbolization is left to the next
+// start-up (see Read) or to an offline tool.
+namespace CrashDump
+{
+// Opens (and truncates) the dump file. Not async-signal-safe, call at start-up.
+bool Open(char const* path);
+void Close();
+
+// Writes the current callstack to the opened dump file.
+// Async-signal-safe: no heap, no locks, no symbolization. Does nothing if no file is open,
+// or if another thread is writing its dump already.
+void Write(int signal, std::size_t ignore = 0);
+
+// Returns the dump left by a previous run (empty if there is none).
+std::string Read(char const* path);
+}
+}
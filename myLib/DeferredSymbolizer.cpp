@@ -0,0 +1,156 @@
+#include "DeferredSymbolizer.h"
+
+#include <sstream>
+#include <utility>
+
+using namespace Navionics;
+
+struct CallstackError::State
+{
+    explicit State(Callstack const& stack)
+        : Stack(stack)
+        , Once()
+        , Text()
+    {
+    }
+
+    Callstack      Stack;
+    std::once_flag Once;
+    std::string    Text;
+};
+
+CallstackError::CallstackError(std::string const& message, std::size_t ignore)
+    : std::runtime_error(message)
+    , m_state(std::make_shared<State>(Callstack(++ignore)))
+{
+    // what() may run once the throwing module is unloaded
+    m_state->Stack.SnapshotModules();
+}
+
+char const* CallstackError::what() const noexcept
+{
+    try
+    {
+        State& state = *m_state;
+        std::call_once(state.Once, [this, &state]() {
+            std::ostringstream stream;
+            stream << Message() << Wide(state.Stack);
+            state.Text = stream.str();
+        });
+        return state.Text.c_str();
+    }
+    catch (...)
+    {
+        return Message();
+    }
+}
+
+char const* CallstackError::Message() const
+{
+    return std::runtime_error::what();
+}
+
+Callstack const& CallstackError::Where() const
+{
+    return m_state->Stack;
+}
+
+DeferredSymbolizer::DeferredSymbolizer(Output output, bool tiny, std::size_t capacity)
+    : m_output(std::move(output))
+    , m_tiny(tiny)
+    , m_capacity(capacity)
+    , m_mutex()
+    , m_wakeup()
+    , m_queue()
+    , m_dropped()
+    , m_stop(false)
+    , m_thread(&DeferredSymbolizer::Run, this)
+{
+}
+
+DeferredSymbolizer::~DeferredSymbolizer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeup.notify_one();
+    m_thread.join();
+}
+
+void DeferredSymbolizer::Post(std::string message, Callstack const& callstack)
+{
+    Entry entry{std::move(message), std::unique_ptr<Callstack>(new Callstack(callstack))};
+    entry.Stack->SnapshotModules();
+    Push(std::move(entry));
+}
+
+void DeferredSymbolizer::Post(std::string message)
+{
+    Push(Entry{std::move(message), nullptr});
+}
+
+void DeferredSymbolizer::Push(Entry entry)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queue.size() >= m_capacity)
+        {
+            ++m_dropped;
+            return;
+        }
+        m_queue.push_back(std::move(entry));
+    }
+    m_wakeup.notify_one();
+}
+
+void DeferredSymbolizer::Run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_wakeup.wait(lock, [this]() { return m_stop || !m_queue.empty() || m_dropped != 0; });
+        if (m_queue.empty() && m_dropped == 0)
+        {
+            // stop requested and nothing left
+            return;
+        }
+
+        std::size_t dropped = m_dropped;
+        m_dropped           = 0;
+        std::deque<Entry> entries;
+        entries.swap(m_queue);
+        lock.unlock();
+
+        for (Entry const& entry : entries)
+        {
+            if (entry.Stack == nullptr)
+            {
+                Emit(entry.Message);
+                continue;
+            }
+            std::ostringstream stream;
+            stream << entry.Message << (m_tiny ? Tiny(*entry.Stack) : Wide(*entry.Stack));
+            Emit(stream.str());
+        }
+        if (dropped != 0)
+        {
+            std::ostringstream stream;
+            stream << dropped << " callstack(s) dropped, symbolizer queue is full";
+            Emit(stream.str());
+        }
+
+        lock.lock();
+    }
+}
+
+void DeferredSymbolizer::Emit(std::string const& text)
+{
+    try
+    {
+        m_output(text);
+    }
+    catch (...) // the worker must outlive a failing output
+    {
+    }
+}
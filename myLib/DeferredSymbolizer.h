@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Callstack.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace Navionics
+{
+// Exception carrying the raw callstack of the throw point.
+// Only the frame addresses and the loaded modules are captured on throw, what() symbolizes them on first use.
+class CallstackError : public std::runtime_error
+{
+public:
+    explicit CallstackError(const std::string& message, std::size_t ignore = 0);
+
+    // message followed by the wide callstack
+    const char* what() const noexcept override;
+
+    const char*      Message() const;
+    const Callstack& Where() const;
+
+private:
+    struct State;
+    std::shared_ptr<State> m_state;
+};
+
+// Turns callstacks into text on a dedicated thread, so the capturing thread
+// only pays for the raw frame addresses.
+class DeferredSymbolizer
+{
+public:
+    using Output = std::function<void(const std::string& text)>;
+
+    explicit DeferredSymbolizer(Output output, bool tiny = false, std::size_t capacity = 1024);
+    // symbolizes everything still queued before returning
+    ~DeferredSymbolizer();
+
+    DeferredSymbolizer(const DeferredSymbolizer&) = delete;
+    DeferredSymbolizer& operator=(const DeferredSymbolizer&) = delete;
+
+    // Never blocks on symbolization; drops the entry if capacity entries are pending.
+    void Post(std::string message, const Callstack& callstack);
+    // Message without callstack, output as is after the entries posted before it.
+    void Post(std::string message);
+
+private:
+    struct Entry
+    {
+        std::string                Message;
+        std::unique_ptr<Callstack> Stack; // null for a plain message
+    };
+
+    void Push(Entry entry);
+
+    void Run();
+    void Emit(const std::string& text);
+
+private:
+    Output const            m_output;
+    bool const              m_tiny;
+    std::size_t const       m_capacity;
+    std::mutex              m_mutex;
+    std::condition_variable m_wakeup;
+    std::deque<Entry>       m_queue;
+    std::size_t             m_dropped;
+    bool                    m_stop;
+    std::thread             m_thread;
+};
+}
@@ -0,0 +1,375 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+
+#ifndef HAS_THREAD_TIMERS
+#   if defined(__linux__) || defined(ANDROID)
+#       define HAS_THREAD_TIMERS 1
+#   else
+#       define HAS_THREAD_TIMERS 0
+#   endif
+#endif // HAS_THREAD_TIMERS
+
+#if HAS_THREAD_TIMERS
+#   include <csignal>
+#   include <ctime>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+// older glibc headers only name the union member
+#   ifndef sigev_notify_thread_id
+#       define sigev_notify_thread_id _sigev_un._tid
+#   endif
+#endif // HAS_THREAD_TIMERS
+
+using namespace Navionics;
+
+struct Profiler::Ring
+{
+    enum
+    {
+        Capacity = 64
+    };
+
+    struct Sample
+    {
+        std::size_t Size;
+        void*       Frames[Callstack::MaxStackLimit];
+    };
+
+    // single producer (the signal handler on the owning thread), single consumer (Drain)
+    Sample                   Samples[Capacity];
+    std::atomic<std::size_t> Head; // next sample written by the handler
+    std::atomic<std::size_t> Tail; // next sample read by the collector
+    std::atomic<std::size_t> Dropped;
+    long                     Thread;
+#if HAS_THREAD_TIMERS
+    timer_t Timer;
+#endif // HAS_THREAD_TIMERS
+
+    explicit Ring(long thread)
+        : Head(0)
+        , Tail(0)
+        , Dropped(0)
+        , Thread(thread)
+    {
+    }
+};
+
+namespace
+{
+
+std::atomic<Profiler*> g_owner(nullptr);
+
+#if HAS_THREAD_TIMERS
+
+// Stop waits for handlers in flight before it frees the rings
+std::atomic<bool> g_enabled(false);
+std::atomic<int>  g_handlers(0);
+struct sigaction  g_oldAction;
+
+inline long CurrentThread()
+{
+    return static_cast<long>(::syscall(SYS_gettid));
+}
+
+void OnProfilingSignal(int, siginfo_t* info, void*)
+{
+    int savedErrno = errno;
+    ++g_handlers;
+    Profiler::Ring* ring = static_cast<Profiler::Ring*>(info->si_value.sival_ptr);
+    if (g_enabled && info->si_code == SI_TIMER && ring != nullptr)
+    {
+        std::size_t head = ring->Head.load(std::memory_order_relaxed);
+        if (head - ring->Tail.load(std::memory_order_acquire) < Profiler::Ring::Capacity)
+        {
+            Profiler::Ring::Sample& sample = ring->Samples[head % Profiler::Ring::Capacity];
+            // skips this handler and the signal trampoline
+            sample.Size = Callstack::Capture(sample.Frames, 2, Callstack::MaxStackLimit);
+            ring->Head.store(head + 1, std::memory_order_release);
+        }
+        else
+        {
+            ring->Dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    --g_handlers;
+    errno = savedErrno;
+}
+
+#endif // HAS_THREAD_TIMERS
+
+// flamegraph.pl splits frames on ';' and the count on the last space
+std::string FrameName(void* address)
+{
+    std::string name = Tiny(Callstack(&address, 1));
+    if (!name.empty() && name[0] == '\n')
+    {
+        name.erase(0, 1);
+    }
+    std::replace(name.begin(), name.end(), ';', ':');
+    return name;
+}
+
+} // namespace
+
+std::size_t Profiler::StackHasher::operator()(Stack const& stack) const
+{
+    return Callstack::HashFrames(stack.data(), stack.size());
+}
+
+Profiler::Profiler(std::chrono::microseconds interval, std::chrono::milliseconds collectInterval)
+    : m_interval(interval)
+    , m_collectInterval(collectInterval)
+    , m_ringsMutex()
+    , m_rings()
+    , m_countsMutex()
+    , m_counts()
+    , m_samples(0)
+    , m_dropped(0)
+    , m_started(false)
+    , m_stopMutex()
+    , m_wakeup()
+    , m_stop(false)
+    , m_thread()
+{
+}
+
+Profiler::~Profiler()
+{
+    Stop();
+}
+
+bool Profiler::Start()
+{
+#if HAS_THREAD_TIMERS
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    Profiler*                   expected = nullptr;
+    if (m_started || !g_owner.compare_exchange_strong(expected, this))
+    {
+        return false;
+    }
+
+    struct sigaction action = {};
+    action.sa_sigaction     = OnProfilingSignal;
+    action.sa_flags         = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &g_oldAction) != 0)
+    {
+        g_owner = nullptr;
+        return false;
+    }
+    g_enabled = true;
+    m_started = true;
+    m_stop    = false;
+    m_thread  = std::thread(&Profiler::Run, this);
+    return true;
+#else  // HAS_THREAD_TIMERS
+    return false;
+#endif // HAS_THREAD_TIMERS
+}
+
+void Profiler::Stop()
+{
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_stopMutex);
+            m_stop = true;
+        }
+        m_wakeup.notify_one();
+        m_thread.join();
+    }
+
+#if HAS_THREAD_TIMERS
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    if (!m_started)
+    {
+        return;
+    }
+    // deleting a timer also discards its pending signal
+    for (std::unique_ptr<Ring> const& ring : m_rings)
+    {
+        timer_delete(ring->Timer);
+    }
+    g_enabled = false;
+    while (g_handlers != 0)
+    {
+        std::this_thread::yield();
+    }
+    for (std::unique_ptr<Ring> const& ring : m_rings)
+    {
+        Drain(*ring);
+    }
+    m_rings.clear();
+    sigaction(SIGPROF, &g_oldAction, nullptr);
+    m_started = false;
+    g_owner   = nullptr;
+#endif // HAS_THREAD_TIMERS
+}
+
+bool Profiler::RegisterThread()
+{
+#if HAS_THREAD_TIMERS
+    long const                  thread = CurrentThread();
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    if (!m_started)
+    {
+        return false;
+    }
+    for (std::unique_ptr<Ring> const& ring : m_rings)
+    {
+        if (ring->Thread == thread)
+        {
+            return true;
+        }
+    }
+
+    std::unique_ptr<Ring> ring(new Ring(thread));
+    struct sigevent       event = {};
+    event.sigev_notify          = SIGEV_THREAD_ID;
+    event.sigev_signo           = SIGPROF;
+    event.sigev_value.sival_ptr = ring.get();
+    event.sigev_notify_thread_id = static_cast<pid_t>(thread);
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &ring->Timer) != 0)
+    {
+        return false;
+    }
+
+    struct itimerspec spec = {};
+    spec.it_interval.tv_sec  = static_cast<time_t>(m_interval.count() / 1000000);
+    spec.it_interval.tv_nsec = static_cast<long>(m_interval.count() % 1000000 * 1000);
+    spec.it_value            = spec.it_interval;
+    if (timer_settime(ring->Timer, 0, &spec, nullptr) != 0)
+    {
+        timer_delete(ring->Timer);
+        return false;
+    }
+    m_rings.push_back(std::move(ring));
+    return true;
+#else  // HAS_THREAD_TIMERS
+    return false;
+#endif // HAS_THREAD_TIMERS
+}
+
+void Profiler::UnregisterThread()
+{
+#if HAS_THREAD_TIMERS
+    long const                  thread = CurrentThread();
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    for (std::vector<std::unique_ptr<Ring>>::iterator it = m_rings.begin(); it != m_rings.end();
+         ++it)
+    {
+        if ((*it)->Thread == thread)
+        {
+            // the handler only runs on this thread, so the ring is not in use past this point
+            timer_delete((*it)->Timer);
+            Drain(**it);
+            m_rings.erase(it);
+            return;
+        }
+    }
+#endif // HAS_THREAD_TIMERS
+}
+
+void Profiler::Collect()
+{
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    for (std::unique_ptr<Ring> const& ring : m_rings)
+    {
+        Drain(*ring);
+    }
+}
+
+void Profiler::Reset()
+{
+    std::lock_guard<std::mutex> lock(m_countsMutex);
+    m_counts.clear();
+    m_samples = 0;
+    m_dropped = 0;
+}
+
+std::size_t Profiler::Samples() const
+{
+    std::lock_guard<std::mutex> lock(m_countsMutex);
+    return m_samples;
+}
+
+std::size_t Profiler::Dropped() const
+{
+    std::lock_guard<std::mutex> lock(m_countsMutex);
+    return m_dropped;
+}
+
+void Profiler::Export(std::ostream& stream) const
+{
+    Counts counts;
+    {
+        std::lock_guard<std::mutex> lock(m_countsMutex);
+        counts = m_counts;
+    }
+
+    // symbolized once per address, outside of the lock; stacks differing only in the
+    // instruction inside the same functions fold into one line
+    std::unordered_map<void*, std::string> names;
+    std::map<std::string, std::size_t>     folded;
+    for (Counts::value_type const& item : counts)
+    {
+        Stack const& stack = item.first;
+        std::string  line;
+        for (Stack::const_reverse_iterator frame = stack.rbegin(); frame != stack.rend(); ++frame)
+        {
+            std::unordered_map<void*, std::string>::iterator name = names.find(*frame);
+            if (name == names.end())
+            {
+                name = names.insert(std::make_pair(*frame, FrameName(*frame))).first;
+            }
+            if (!line.empty())
+            {
+                line += ';';
+            }
+            line += name->second;
+        }
+        if (!line.empty())
+        {
+            folded[line] += item.second;
+        }
+    }
+    for (std::map<std::string, std::size_t>::value_type const& item : folded)
+    {
+        stream << item.first << ' ' << item.second << '\n';
+    }
+}
+
+void Profiler::Run()
+{
+    std::unique_lock<std::mutex> lock(m_stopMutex);
+    while (!m_wakeup.wait_for(lock, m_collectInterval, [this]() { return m_stop; }))
+    {
+        lock.unlock();
+        Collect();
+        lock.lock();
+    }
+}
+
+// m_ringsMutex must be held
+void Profiler::Drain(Ring& ring)
+{
+    std::size_t tail = ring.Tail.load(std::memory_order_relaxed);
+    std::size_t head = ring.Head.load(std::memory_order_acquire);
+
+    std::lock_guard<std::mutex> lock(m_countsMutex);
+    for (; tail != head; ++tail)
+    {
+        Ring::Sample const& sample = ring.Samples[tail % Ring::Capacity];
+        ++m_counts[Stack(sample.Frames, sample.Frames + sample.Size)];
+        ++m_samples;
+    }
+    ring.Tail.store(tail, std::memory_order_release);
+    m_dropped += ring.Dropped.exchange(0, std::memory_order_relaxed);
+}
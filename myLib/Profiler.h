@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Callstack.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Navionics
+{
+// In-process sampling CPU profiler.
+// Every registered thread gets a timer on its own CPU clock (CLOCK_THREAD_CPUTIME_ID) which
+// raises SIGPROF on that thread; the handler captures the raw callstack into a lock-free ring
+// owned by the thread. A collector thread drains the rings and counts distinct callstacks,
+// symbolization only happens on Export.
+//
+// Only one profiler can be started at a time, the SIGPROF handler is process wide.
+// Available where POSIX per-thread timers exist (Linux, Android), Start fails elsewhere.
+class Profiler
+{
+public:
+    explicit Profiler(std::chrono::microseconds interval = std::chrono::milliseconds(10),
+                      std::chrono::milliseconds collectInterval = std::chrono::milliseconds(100));
+    // stops profiling, registered threads do not need to unregister
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Installs the SIGPROF handler and starts the collector.
+    // Returns false if another profiler is running or the platform has no per-thread timers.
+    bool Start();
+    void Stop();
+
+    // Samples the calling thread while the profiler is started
+    bool RegisterThread();
+    void UnregisterThread();
+
+    // Drains the thread rings now instead of waiting for the collector
+    void Collect();
+    // Forgets the samples collected so far
+    void Reset();
+
+    std::size_t Samples() const;
+    // samples lost because a ring was full when the collector was late
+    std::size_t Dropped() const;
+
+    // Writes the collected samples as collapsed stacks, one "root;...;leaf count" line per
+    // distinct callstack, the input format of flamegraph.pl
+    void Export(std::ostream& stream) const;
+
+    struct Ring;
+
+private:
+    using Stack = std::vector<void*>;
+
+    struct StackHasher
+    {
+        std::size_t operator()(const Stack& stack) const;
+    };
+
+    using Counts = std::unordered_map<Stack, std::size_t, StackHasher>;
+
+    void Run();
+    void Drain(Ring& ring);
+
+private:
+    std::chrono::microseconds const    m_interval;
+    std::chrono::milliseconds const    m_collectInterval;
+    std::mutex                         m_ringsMutex;
+    std::vector<std::unique_ptr<Ring>> m_rings;
+    mutable std::mutex                 m_countsMutex;
+    Counts                             m_counts;
+    std::size_t                        m_samples;
+    std::size_t                        m_dropped;
+    bool                               m_started;
+    std::mutex                         m_stopMutex;
+    std::condition_variable            m_wakeup;
+    bool                               m_stop;
+    std::thread                        m_thread;
+};
+}
@@ -5,19 +5,25 @@
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/android_sink.h"
 #include "Callstack.h"
+#include "CallstackAggregator.h"
+#include "CrashDump.h"
+#include "DeferredSymbolizer.h"
 
 static std::shared_ptr<spdlog::logger> g_logger;
+static std::unique_ptr<Navionics::CallstackAggregator> g_exceptions;
 
 namespace {
     struct sigaction old_sa[NSIG];
 
+    // Only async-signal-safe calls here: the logger and the symbolizer allocate and lock,
+    // which turns a crash on a loaded process into a hang.
     void android_sigaction(int signal, siginfo_t *info, void *reserved) {
         using namespace Navionics;
         //(*env)->CallVoidMethod(env, obj, nativeCrashed);
-        Callstack stk;
-        g_logger->critical("Signal received: {}", signal);
-        g_logger->critical(Wide(stk));
-        old_sa[signal].sa_handler(signal);
+        CrashDump::Write(signal);
+        // chain to the previous handler once this one returns
+        sigaction(signal, &old_sa[signal], nullptr);
+        raise(signal);
     }
 }
 
@@ -45,8 +51,8 @@ struct T
 
     void throwException() {
         using namespace Navionics;
-        Callstack stk;
-        throw std::runtime_error(Wide(stk));
+        // only raw addresses are captured here, symbolization happens off this thread
+        throw CallstackError("T::throwException failed");
     }
 };
 
@@ -58,6 +64,10 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *jvm, void *reserved)
     auto androidSink = std::make_shared<spdlog::sinks::android_sink_mt>("launcher.uvdemo.app");
     g_logger= spdlog::create("MyLib", {androidSink});
     g_logger->info("Initialize MyLib");
+    // the first occurrence of an exception is logged at once with its callstack, symbolized
+    // by the deferred symbolizer of the aggregator; repeats are logged once per minute with a count
+    g_exceptions.reset(new Navionics::CallstackAggregator(g_logger, std::chrono::minutes(1),
+                                                          spdlog::level::err));
 
     // Try to catch crashes...
     {
@@ -78,6 +88,23 @@ JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *jvm, void *reserved)
     return JNI_VERSION_1_2;
 }
 
+JNIEXPORT void JNICALL Java_launcher_uvdemo_app_MyLib_setCrashDumpFile(JNIEnv* env, jobject obj, jstring path)
+{
+    using namespace Navionics;
+    const char* fileName = env->GetStringUTFChars(path, nullptr);
+    if (fileName == nullptr)
+        return;
+
+    // report the crash of the previous run before the file is reused
+    std::string previous = CrashDump::Read(fileName);
+    if (!previous.empty())
+        g_logger->critical("Previous run crashed:\n{}", previous);
+
+    if (!CrashDump::Open(fileName))
+        g_logger->error("Failed to open crash dump file {}", fileName);
+    env->ReleaseStringUTFChars(path, fileName);
+}
+
 JNIEXPORT void JNICALL Java_launcher_uvdemo_app_MyLib_boom(JNIEnv* env, jobject obj)
 {
     g_logger->info("crash application");
@@ -91,6 +118,11 @@ JNIEXPORT void JNICALL Java_launcher_uvdemo_app_MyLib_throwException(JNIEnv* env
     try{
         T t;
         t.foo3();
+    } catch(const Navionics::CallstackError& e) {
+        g_exceptions->Add(e.Where(), e.Message());
+        jclass newExcCls = env->FindClass("java/lang/Error");
+        if (newExcCls != nullptr)
+            env->ThrowNew(newExcCls, e.Message());
     } catch(std::runtime_error e) {
         jclass newExcCls = env->FindClass("java/lang/Error");
         if (newExcCls != nullptr)
@@ -0,0 +1,80 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// Contention of the logging threads on the async queue, for each async_queue_type:
+// the threads log to a null sink, so the time is spent pushing to the queue.
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/null_sink.h"
+
+using namespace std;
+
+void bench_queue(const char* name, spdlog::async_queue_type queue_type, int thread_count, int howmany)
+{
+    namespace spd = spdlog;
+    using clock = std::chrono::steady_clock;
+
+    // the per thread queues are sized for their share of the messages
+    size_t queue_size = 1048576;
+    if (queue_type == spd::async_queue_type::per_thread)
+    {
+        queue_size = 2;
+        while (queue_size < static_cast<size_t>(howmany / thread_count))
+            queue_size *= 2;
+    }
+    spd::set_async_mode(queue_size, spd::async_overflow_policy::block_retry, nullptr, std::chrono::milliseconds::zero(), nullptr, queue_type);
+    auto logger = spd::create<spd::sinks::null_sink_mt>("contention_logger");
+
+    std::atomic<int> msg_counter {0};
+    vector<thread> threads;
+    auto start = clock::now();
+    for (int t = 0; t < thread_count; ++t)
+    {
+        threads.push_back(std::thread([&]()
+        {
+            while (true)
+            {
+                int counter = ++msg_counter;
+                if (counter > howmany) break;
+                logger->info("spdlog message #{}: This is some text for your pleasure", counter);
+            }
+        }));
+    }
+    for (auto &t : threads)
+        t.join();
+    std::chrono::duration<double> pushed = clock::now() - start;
+
+    spd::drop("contention_logger");
+    logger.reset();
+    std::chrono::duration<double> written = clock::now() - start;
+
+    cout << name << ", " << thread_count << " threads: "
+         << "push = " << pushed.count() * 1e9 / howmany << " ns/msg, "
+         << "written rate = " << static_cast<int>(howmany / written.count()) << "/sec" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    namespace spd = spdlog;
+
+    int max_threads = 10;
+    if(argc > 1)
+        max_threads = ::atoi(argv[1]);
+    int howmany = 1000000;
+
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        bench_queue("mpmc", spd::async_queue_type::mpmc, threads, howmany);
+        bench_queue("mpsc", spd::async_queue_type::mpsc, threads, howmany);
+        bench_queue("per_thread", spd::async_queue_type::per_thread, threads, howmany);
+    }
+    spd::set_sync_mode();
+}
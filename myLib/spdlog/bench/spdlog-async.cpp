@@ -9,10 +9,126 @@
 #include <iostream>
 #include <chrono>
 #include <cstdlib>
+#include <algorithm>
+#include <mutex>
 #include "spdlog/spdlog.h"
 
 using namespace std;
 
+// records the delay between the log call and the sink write
+class latency_sink : public spdlog::sinks::sink
+{
+public:
+    void log(const spdlog::details::log_msg& msg) override
+    {
+        auto delay = spdlog::log_clock::now() - msg.time;
+        std::lock_guard<std::mutex> lock(_mutex);
+        _delays.push_back(std::chrono::duration_cast<std::chrono::microseconds>(delay));
+    }
+    void flush() override
+    {}
+
+    std::vector<std::chrono::microseconds> delays()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _delays;
+    }
+
+private:
+    std::mutex _mutex;
+    std::vector<std::chrono::microseconds> _delays;
+};
+
+// Wake-up latency of the async worker: single messages logged after idle periods
+void bench_latency(int samples, std::chrono::milliseconds idle)
+{
+    namespace spd = spdlog;
+    auto sink = std::make_shared<latency_sink>();
+    auto logger = spd::create("latency_logger", { sink });
+    for (int i = 0; i < samples; ++i)
+    {
+        std::this_thread::sleep_for(idle);
+        logger->info("latency message #{}", i);
+    }
+    // let the worker catch up before the logger goes away
+    std::this_thread::sleep_for(idle + std::chrono::milliseconds(300));
+    spd::drop("latency_logger");
+
+    auto delays = sink->delays();
+    if (delays.empty())
+        return;
+    std::sort(delays.begin(), delays.end());
+    std::cout << "Idle " << idle.count() << " ms: "
+              << "p50 = " << delays[delays.size() / 2].count() << " us, "
+              << "p99 = " << delays[delays.size() * 99 / 100].count() << " us, "
+              << "max = " << delays.back().count() << " us" << std::endl;
+}
+
+// Cost of the async worker alone: the worker is held back in its warmup callback until the
+// queue is filled, then the time to drain it to the file is measured
+void bench_worker(int howmany)
+{
+    namespace spd = spdlog;
+    using clock = std::chrono::steady_clock;
+
+    std::atomic<bool> go { false };
+    spd::set_async_mode(1048576, spd::async_overflow_policy::block_retry, [&go]()
+    {
+        while (!go)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    auto logger = spd::create<spd::sinks::simple_file_sink_mt>("worker_logger", "logs/spd-bench-worker.txt", false);
+    logger->set_pattern("[%Y-%b-%d %T.%e]: %v");
+    for (int i = 0; i < howmany; ++i)
+        logger->info() << "spdlog message #" << i << ": This is some text for your pleasure";
+
+    auto start = clock::now();
+    go = true;
+    spd::drop("worker_logger");
+    logger.reset();
+    std::chrono::duration<double> delta = clock::now() - start;
+    std::cout << "Worker = " << delta.count() * 1e9 / howmany << " ns/msg" << std::endl;
+
+    // the warmup callback refers to a local
+    spd::set_async_mode(1048576);
+}
+
+// Cost on the logging thread of formatting there (eager) or on the worker (deferred): the worker
+// is held back so only the producer side is measured, then the time to drain the queue
+void bench_deferred(int howmany, bool deferred)
+{
+    namespace spd = spdlog;
+    using clock = std::chrono::steady_clock;
+
+    std::atomic<bool> go { false };
+    spd::set_async_mode(1048576, spd::async_overflow_policy::block_retry, [&go]()
+    {
+        while (!go)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    auto logger = std::static_pointer_cast<spd::async_logger>(
+                      spd::create<spd::sinks::simple_file_sink_mt>("deferred_logger", "logs/spd-bench-deferred.txt", false));
+    logger->set_pattern("[%Y-%b-%d %T.%e]: %v");
+    logger->set_deferred_formatting(deferred);
+    std::string user = "pleasure";
+    auto start = clock::now();
+    for (int i = 0; i < howmany; ++i)
+        logger->info("spdlog message #{}: {:.3f} ms, ratio {:08x}, this is some text for your {}", i, i * 0.001, i * 7, user);
+    std::chrono::duration<double> logged = clock::now() - start;
+
+    start = clock::now();
+    go = true;
+    spd::drop("deferred_logger");
+    logger.reset();
+    std::chrono::duration<double> drained = clock::now() - start;
+    std::cout << (deferred ? "Deferred" : "Eager") << " formatting: "
+              << "producer = " << logged.count() * 1e9 / howmany << " ns/msg, "
+              << "worker = " << drained.count() * 1e9 / howmany << " ns/msg" << std::endl;
+
+    // the warmup callback refers to a local
+    spd::set_async_mode(1048576);
+}
+
 int main(int argc, char* argv[])
 {
 
@@ -59,4 +175,17 @@ int main(int argc, char* argv[])
     cout << "Threads: " << thread_count << std::endl;
     std::cout << "Delta = " << deltaf << " seconds" << std::endl;
     std::cout << "Rate = " << rate << "/sec" << std::endl;
+
+    // the worker thread joins once the last reference is gone: everything is in the file then
+    spd::drop("file_logger");
+    logger.reset();
+    duration<float> written = clock::now() - start;
+    std::cout << "Written rate = " << howmany / written.count() << "/sec" << std::endl;
+
+    bench_worker(howmany);
+    bench_deferred(howmany, false);
+    bench_deferred(howmany, true);
+    bench_latency(50, milliseconds(1));
+    bench_latency(20, milliseconds(50));
+    bench_latency(20, milliseconds(250));
 }
@@ -0,0 +1,92 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// Sustained throughput of the file sinks: stdio based simple_file_sink against fd_file_sink,
+// with the durability policies of the latter, and mmap_ring_sink.
+// Then the latency of the log calls of rotating_file_sink, rotating in place or in the background
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/fd_file_sink.h"
+#include "spdlog/sinks/mmap_ring_sink.h"
+
+namespace
+{
+template<class Sink>
+void bench(const std::string& title, const std::shared_ptr<Sink>& sink, int howmany)
+{
+    using clock = std::chrono::steady_clock;
+    spdlog::logger logger("bench", sink);
+    logger.set_pattern("[%Y-%b-%d %T.%e]: %v");
+
+    auto start = clock::now();
+    for (int i = 0; i < howmany; ++i)
+        logger.info("spdlog message #{}: This is some text for your pleasure", i);
+    logger.flush();
+    auto delta = std::chrono::duration_cast<std::chrono::duration<double>>(clock::now() - start).count();
+    std::cout << title << ": " << int(howmany / delta) << " msg/sec, " << int(delta * 1e9 / howmany) << " ns/msg" << std::endl;
+}
+
+void bench_rotation(const std::string& title, spdlog::rotation_mode mode, int howmany)
+{
+    using clock = std::chrono::steady_clock;
+    auto sink = std::make_shared<spdlog::sinks::rotating_file_sink_st>("logs/spd-file-rotating", "txt", 1024 * 1024, 10, false, mode);
+    spdlog::logger logger("bench", sink);
+    logger.set_pattern("[%Y-%b-%d %T.%e]: %v");
+
+    std::vector<clock::duration> latencies(howmany);
+    for (int i = 0; i < howmany; ++i)
+    {
+        auto start = clock::now();
+        logger.info("spdlog message #{}: This is some text for your pleasure", i);
+        latencies[i] = clock::now() - start;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto ns = [&latencies](double percentile)
+    {
+        auto index = std::min(latencies.size() - 1, static_cast<size_t>(latencies.size() * percentile));
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(latencies[index]).count();
+    };
+    std::cout << title << ": p50 " << ns(0.5) << " ns, p99 " << ns(0.99) << " ns, p99.99 " << ns(0.9999) << " ns, max " << ns(1.0) << " ns" << std::endl;
+}
+
+void print_stats(const spdlog::fd_file_stats& stats)
+{
+    std::cout << "    " << stats.bytes_written << " bytes, " << stats.write_calls << " writes, " << stats.sync_calls << " syncs" << std::endl;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    int howmany = argc > 1 ? atoi(argv[1]) : 1000000;
+    namespace spd = spdlog;
+
+    bench("simple_file_sink_st", std::make_shared<spd::sinks::simple_file_sink_st>("logs/spd-file-stdio.txt"), howmany);
+    bench("simple_file_sink_st (force_flush)", std::make_shared<spd::sinks::simple_file_sink_st>("logs/spd-file-stdio-ff.txt", true), howmany / 10);
+
+    auto fd_sink = std::make_shared<spd::sinks::fd_file_sink_st>("logs/spd-file-fd.txt");
+    bench("fd_file_sink_st", fd_sink, howmany);
+    print_stats(fd_sink->stats());
+
+    auto bytes_sink = std::make_shared<spd::sinks::fd_file_sink_st>("logs/spd-file-fd-bytes.txt", spd::durability_policy::every_bytes(4 * 1024 * 1024));
+    bench("fd_file_sink_st (sync every 4 MB)", bytes_sink, howmany);
+    print_stats(bytes_sink->stats());
+
+    auto ms_sink = std::make_shared<spd::sinks::fd_file_sink_st>("logs/spd-file-fd-ms.txt", spd::durability_policy::every_ms(100));
+    bench("fd_file_sink_st (sync every 100 ms)", ms_sink, howmany);
+    print_stats(ms_sink->stats());
+
+    bench("mmap_ring_sink_st (64 MB)", std::make_shared<spd::sinks::mmap_ring_sink_st>("logs/spd-file-ring.bin", 64 * 1024 * 1024, true), howmany);
+
+    bench_rotation("rotating_file_sink_st (1 MB x 10, in place)", spd::rotation_mode::in_place, howmany);
+    bench_rotation("rotating_file_sink_st (1 MB x 10, background)", spd::rotation_mode::background, howmany);
+    return 0;
+}
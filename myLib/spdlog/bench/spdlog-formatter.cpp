@@ -0,0 +1,75 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// Cost of formatting a message with the runtime pattern_formatter ("%+" and the same pattern
+// spelled out flag by flag) and with the compile time static_pattern_formatter
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "spdlog/spdlog.h"
+
+namespace
+{
+struct full_pattern
+{
+    static constexpr const char* pattern()
+    {
+        return "%+";
+    }
+};
+
+struct spelled_out_pattern
+{
+    static constexpr const char* pattern()
+    {
+        return "[%Y-%m-%d %H:%M:%S.%e] [%n] [%l] %v";
+    }
+};
+
+// best of a few rounds, the message time advances by one microsecond per message
+void bench(const char* name, spdlog::formatter& formatter, int howmany)
+{
+    using clock = std::chrono::steady_clock;
+    std::string logger_name = "bench_logger";
+    spdlog::details::log_msg msg(spdlog::level::info);
+    msg.logger_name = &logger_name;
+    msg.raw << "spdlog message: This is some text for your pleasure";
+
+    auto best = std::chrono::duration<double>::max();
+    for (int round = 0; round < 5; ++round)
+    {
+        auto time = spdlog::log_clock::now();
+        auto start = clock::now();
+        for (int i = 0; i < howmany; ++i)
+        {
+            msg.formatted.clear();
+            msg.time = time + std::chrono::microseconds(i);
+            formatter.format(msg);
+        }
+        best = std::min<std::chrono::duration<double>>(best, clock::now() - start);
+    }
+    std::cout << name << ": " << best.count() * 1e9 / howmany << " ns/msg" << std::endl;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    int howmany = 2000000;
+    if (argc > 1)
+        howmany = ::atoi(argv[1]);
+
+    spdlog::pattern_formatter runtime_full(full_pattern::pattern());
+    spdlog::pattern_formatter runtime_spelled_out(spelled_out_pattern::pattern());
+    spdlog::static_pattern_formatter<full_pattern> static_full;
+    spdlog::static_pattern_formatter<spelled_out_pattern> static_spelled_out;
+
+    bench("pattern_formatter %+", runtime_full, howmany);
+    bench("pattern_formatter [%Y-%m-%d %H:%M:%S.%e] [%n] [%l] %v", runtime_spelled_out, howmany);
+    bench("static_pattern_formatter %+", static_full, howmany);
+    bench("static_pattern_formatter [%Y-%m-%d %H:%M:%S.%e] [%n] [%l] %v", static_spelled_out, howmany);
+}
@@ -0,0 +1,86 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+// Cost of spdlog::get() with many reader threads, among a few registered loggers,
+// with and without a writer creating and dropping loggers meanwhile
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/null_sink.h"
+
+namespace
+{
+void bench(int thread_count, int howmany, bool writer)
+{
+    using clock = std::chrono::steady_clock;
+    std::vector<std::string> names;
+    for (int i = 0; i < 16; ++i)
+        names.push_back("logger_" + std::to_string(i));
+
+    std::atomic<bool> done { false };
+    std::thread churn;
+    if (writer)
+    {
+        churn = std::thread([&done]()
+        {
+            while (!done)
+            {
+                spdlog::create<spdlog::sinks::null_sink_mt>("churn_logger");
+                spdlog::drop("churn_logger");
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+
+    std::atomic<size_t> found { 0 };
+    std::vector<std::thread> threads;
+    auto start = clock::now();
+    for (int t = 0; t < thread_count; ++t)
+    {
+        threads.emplace_back([&names, &found, howmany, t]()
+        {
+            size_t local_found = 0;
+            for (int i = 0; i < howmany; ++i)
+                local_found += spdlog::get(names[(i + t) % names.size()]) != nullptr;
+            found += local_found;
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    std::chrono::duration<double> delta = clock::now() - start;
+    done = true;
+    if (churn.joinable())
+        churn.join();
+
+    std::cout << "Threads: " << thread_count << (writer ? " + writer" : "") << ", "
+              << delta.count() * 1e9 / (static_cast<double>(howmany) * thread_count) << " ns/get "
+              << "(" << found << " found)" << std::endl;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    int max_threads = std::max(4, static_cast<int>(std::thread::hardware_concurrency()));
+    if (argc > 1)
+        max_threads = ::atoi(argv[1]);
+    int howmany = 1000000;
+
+    for (int i = 0; i < 16; ++i)
+        spdlog::create<spdlog::sinks::null_sink_mt>("logger_" + std::to_string(i));
+
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        bench(threads, howmany, false);
+        bench(threads, howmany, true);
+    }
+    spdlog::drop_all();
+}
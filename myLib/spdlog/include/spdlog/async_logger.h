@@ -7,7 +7,8 @@
 
 // Very fast asynchronous logger (millions of logs per second on an average desktop)
 // Uses pre allocated lockfree queue for maximum throughput even under large number of threads.
-// Creates a single back thread to pop messages from the queue and log them.
+// Creates a single back thread to pop messages from the queue and log them,
+// or one thread and queue for each sink with async_workers::per_sink.
 //
 // Upon each log write the logger:
 //    1. Checks if its log level is enough to log the message
@@ -22,6 +23,7 @@
 #include <functional>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace spdlog
 {
@@ -42,7 +44,9 @@ public:
                  const async_overflow_policy overflow_policy =  async_overflow_policy::block_retry,
                  const std::function<void()>& worker_warmup_cb = nullptr,
                  const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero(),
-                 const std::function<void()>& worker_teardown_cb = nullptr);
+                 const std::function<void()>& worker_teardown_cb = nullptr,
+                 const async_queue_type queue_type = async_queue_type::mpmc,
+                 const async_workers workers = async_workers::per_logger);
 
     async_logger(const std::string& logger_name,
                  sinks_init_list sinks,
@@ -50,7 +54,9 @@ public:
                  const async_overflow_policy overflow_policy = async_overflow_policy::block_retry,
                  const std::function<void()>& worker_warmup_cb = nullptr,
                  const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero(),
-                 const std::function<void()>& worker_teardown_cb = nullptr);
+                 const std::function<void()>& worker_teardown_cb = nullptr,
+                 const async_queue_type queue_type = async_queue_type::mpmc,
+                 const async_workers workers = async_workers::per_logger);
 
     async_logger(const std::string& logger_name,
                  sink_ptr single_sink,
@@ -58,9 +64,24 @@ public:
                  const async_overflow_policy overflow_policy =  async_overflow_policy::block_retry,
                  const std::function<void()>& worker_warmup_cb = nullptr,
                  const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero(),
-                 const std::function<void()>& worker_teardown_cb = nullptr);
+                 const std::function<void()>& worker_teardown_cb = nullptr,
+                 const async_queue_type queue_type = async_queue_type::mpmc,
+                 const async_workers workers = async_workers::per_logger);
 
 
+    // Format the messages on the worker thread instead of the logging thread, which then only
+    // copies the format string and the arguments into the queue.
+    // Only the calls whose arguments are numbers, strings or pointers are deferred, the others
+    // are formatted as before.
+    // A bad format string is logged as an error message instead of throwing to the caller.
+    void set_deferred_formatting(bool deferred);
+
+    // Stop the worker threads: the queued messages are written until the deadline, the rest and
+    // the messages logged from now on are discarded. Never waits past the deadline: a worker
+    // still running then stops calling the sinks, and the sinks it is not stuck in are flushed
+    // on the calling thread. Calling it again returns the same report.
+    shutdown_report shutdown(const std::chrono::steady_clock::time_point& deadline);
+
     void flush() override;
 protected:
     void _log_msg(details::log_msg& msg) override;
@@ -68,7 +89,7 @@ protected:
     void _set_pattern(const std::string& pattern) override;
 
 private:
-    std::unique_ptr<details::async_log_helper> _async_log_helper;
+    std::vector<std::shared_ptr<details::async_log_helper>> _async_log_helpers;
 };
 }
 
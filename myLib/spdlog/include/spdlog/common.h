@@ -11,6 +11,8 @@
 #include <memory>
 #include <atomic>
 #include <exception>
+#include <cstddef>
+#include <cstdint>
 #if defined(_WIN32) && defined(SPDLOG_WCHAR_FILENAMES)
 #include <codecvt>
 #include <locale>
@@ -87,7 +89,89 @@ inline const char* to_short_str(spdlog::level::level_enum l)
 enum class async_overflow_policy
 {
     block_retry, // Block / yield / sleep until message can be enqueued
-    discard_log_msg // Discard the message it enqueue fails
+    discard_log_msg, // Discard the message it enqueue fails
+    overrun_oldest, // Discard the oldest message in the queue to make room for the new one (mpmc queue only)
+    discard_below_level // Discard the messages below warn, keep the others in the priority queue
+};
+
+//
+// Queue between the threads logging to an async logger and its worker thread
+//
+enum class async_queue_type
+{
+    mpmc, // One queue shared by all threads
+    mpsc, // One queue shared by all threads, the worker dequeues without compare and swap loops
+    per_thread // One single producer queue of queue_size entries for each thread logging to the logger
+};
+
+//
+// Worker threads of an async logger
+//
+enum class async_workers
+{
+    per_logger, // One worker thread and queue for all the sinks of the logger
+    per_sink // One worker thread and queue for each sink of the logger, so a slow sink does not hold back the others
+};
+
+//
+// Outcome of shutting down async loggers, see spdlog::shutdown()
+//
+struct shutdown_report
+{
+    // messages discarded: logged once the shutdown started, or still queued at the deadline
+    size_t lost = 0;
+    // workers which missed the deadline, stuck in a sink or a callback. they are left to finish on their own
+    // and the messages they had not reached yet are discarded without being counted in lost
+    size_t workers_abandoned = 0;
+};
+
+//
+// How rotating_file_sink rotates its files once the current one is full
+//
+enum class rotation_mode
+{
+    in_place, // Close, rename the files and reopen, on the thread logging the message
+    background // Switch to a file opened in advance, the files are renamed by a thread of the sink (in_place on windows)
+};
+
+//
+// When fd_file_sink asks the kernel to put the written data on disk (fdatasync)
+// Both limits can be set, a zero value disables the limit. Without limits the data is left to the kernel.
+//
+struct durability_policy
+{
+    static durability_policy none()
+    {
+        return durability_policy();
+    }
+    static durability_policy every_ms(unsigned int ms)
+    {
+        durability_policy policy;
+        policy.sync_interval = std::chrono::milliseconds(ms);
+        return policy;
+    }
+    static durability_policy every_bytes(size_t bytes)
+    {
+        durability_policy policy;
+        policy.sync_bytes = bytes;
+        return policy;
+    }
+
+    // sync once a write or a flush happens this long after the last sync. Without further
+    // messages only flush() syncs the last ones, e.g. run by the async worker every flush_interval_ms
+    std::chrono::milliseconds sync_interval = std::chrono::milliseconds::zero();
+    // sync once this many bytes were written since the last sync
+    size_t sync_bytes = 0;
+};
+
+//
+// Counters of fd_file_sink
+//
+struct fd_file_stats
+{
+    uint64_t bytes_written = 0; // bytes handed to the kernel
+    uint64_t write_calls = 0; // write and writev syscalls
+    uint64_t sync_calls = 0; // fdatasync syscalls
 };
 
 
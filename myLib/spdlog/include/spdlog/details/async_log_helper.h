@@ -9,6 +9,10 @@
 // If the internal queue of log messages reaches its max size,
 // then the client call will block until there is more room.
 //
+// Both the back thread (on an empty queue) and the clients (on a full queue) spin and
+// yield for a short while, then block on a condition variable until the other side
+// signals progress, so an idle logger takes no cpu and still wakes up right away.
+//
 // If the back thread throws during logging, a spdlog::spdlog_ex exception
 // will be thrown in client's thread when tries to log the next message
 
@@ -16,67 +20,139 @@
 
 #include <spdlog/common.h>
 #include <spdlog/sinks/sink.h>
-#include <spdlog/details/mpmc_bounded_q.h>
+#include <spdlog/details/async_queue.h>
+#include <spdlog/details/deferred_format.h>
 #include <spdlog/details/log_msg.h>
+#include <spdlog/details/log_batch.h>
 #include <spdlog/details/os.h>
+#include <spdlog/details/string_pool.h>
 #include <spdlog/formatter.h>
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
 #include <exception>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <utility>
 #include <vector>
 
+// max number of messages the worker drains from the queue and hands to the sinks at once
+#ifndef SPDLOG_ASYNC_BATCH_SIZE
+#define SPDLOG_ASYNC_BATCH_SIZE 64
+#endif
+
+// size of the queue taking critical messages (and the ones kept by discard_below_level) once the main queue is full
+#ifndef SPDLOG_ASYNC_PRIORITY_QUEUE_SIZE
+#define SPDLOG_ASYNC_PRIORITY_QUEUE_SIZE 64
+#endif
+
+// min time between two reports of the messages dropped on a full queue
+#ifndef SPDLOG_ASYNC_DROP_REPORT_INTERVAL_MS
+#define SPDLOG_ASYNC_DROP_REPORT_INTERVAL_MS 1000
+#endif
+
+// messages up to this size are stored in the queue slot itself, longer ones in a pooled string.
+// the default makes queue cells of 128 bytes
+#ifndef SPDLOG_ASYNC_INLINE_MSG_SIZE
+#define SPDLOG_ASYNC_INLINE_MSG_SIZE 104
+#endif
+
 namespace spdlog
 {
 namespace details
 {
 
-class async_log_helper
+class async_log_helper : public std::enable_shared_from_this<async_log_helper>
 {
     // Async msg to move to/from the queue
     // Movable only. should never be copied
-    enum class async_msg_type
+    enum class async_msg_type : uint8_t
     {
         log,
+        // the text is a copy of the format string pointer and the arguments, see deferred_format.h
+        log_deferred,
         flush,
         terminate
     };
+
+    // thread ids from gettid() and GetCurrentThreadId() fit in 32 bits, the std::thread::id hash does not
+#if defined(_WIN32) || defined(__linux__)
+    using msg_thread_id = uint32_t;
+#else
+    using msg_thread_id = size_t;
+#endif
+
+    // A 16 bytes header followed by the text, so a queue cell is 2 cache lines by default and
+    // a message of up to 40 chars only touches the first one.
+    // The logger name is not stored, all the messages come from the logger owning the helper.
     struct async_msg
     {
-        std::string logger_name;
-        level::level_enum level;
-        log_clock::time_point time;
-        size_t thread_id;
-        std::string txt;
+        // ticks of log_clock since its epoch
+        log_clock::rep time;
+        msg_thread_id thread_id;
+        uint8_t level;
         async_msg_type msg_type;
+        // overflow_size when the text is in overflow_txt (taken from the helper's pool)
+        uint16_t txt_size;
+        union
+        {
+            char txt_inline[SPDLOG_ASYNC_INLINE_MSG_SIZE];
+            std::string* overflow_txt;
+        };
+
+        static const uint16_t overflow_size = 0xffff;
+
+        async_msg() :
+            time(0),
+            thread_id(0),
+            level(level::off),
+            msg_type(async_msg_type::log),
+            txt_size(0)
+        {}
 
-        async_msg() = default;
-        ~async_msg() = default;
-
+        ~async_msg()
+        {
+            if (txt_size == overflow_size)
+                delete overflow_txt;
+        }
 
-async_msg(async_msg&& other) SPDLOG_NOEXCEPT:
-        logger_name(std::move(other.logger_name)),
-                    level(std::move(other.level)),
-                    time(std::move(other.time)),
-                    txt(std::move(other.txt)),
-                    msg_type(std::move(other.msg_type))
-        {}
+        async_msg(async_msg&& other) SPDLOG_NOEXCEPT :
+            txt_size(0)
+        {
+            *this = std::move(other);
+        }
 
-        async_msg(async_msg_type m_type) :msg_type(m_type)
-        {};
+        async_msg(async_msg_type m_type) :async_msg()
+        {
+            msg_type = m_type;
+        }
 
         async_msg& operator=(async_msg&& other) SPDLOG_NOEXCEPT
         {
-            logger_name = std::move(other.logger_name);
-            level = other.level;
-            time = std::move(other.time);
+            if (this == &other)
+                return *this;
+            if (txt_size == overflow_size)
+                delete overflow_txt;
+            time = other.time;
             thread_id = other.thread_id;
-            txt = std::move(other.txt);
+            level = other.level;
             msg_type = other.msg_type;
+            txt_size = other.txt_size;
+            if (txt_size == overflow_size)
+            {
+                overflow_txt = other.overflow_txt;
+                other.txt_size = 0;
+            }
+            else
+            {
+                std::memcpy(txt_inline, other.txt_inline, txt_size);
+            }
             return *this;
         }
 
@@ -85,44 +161,100 @@ async_msg(async_msg&& other) SPDLOG_NOEXCEPT:
         async_msg& operator=(async_msg& other) = delete;
 
         // construct from log_msg
-        async_msg(const details::log_msg& m) :
-            logger_name(m.logger_name),
-            level(m.level),
-            time(m.time),
-            thread_id(m.thread_id),
-            txt(m.raw.data(), m.raw.size()),
-            msg_type(async_msg_type::log)
-        {}
-
+        async_msg(const details::log_msg& m, string_pool& txt_pool) :
+            time(m.time.time_since_epoch().count()),
+            thread_id(static_cast<msg_thread_id>(m.thread_id)),
+            level(static_cast<uint8_t>(m.level)),
+            msg_type(m.fmt_str ? async_msg_type::log_deferred : async_msg_type::log)
+        {
+            if (m.fmt_str)
+            {
+                auto size = deferred_size(m);
+                write_deferred(m, reserve_txt(size, txt_pool));
+            }
+            else
+            {
+                std::memcpy(reserve_txt(m.raw.size(), txt_pool), m.raw.data(), m.raw.size());
+            }
+        }
 
+        bool is_log() const
+        {
+            return msg_type == async_msg_type::log || msg_type == async_msg_type::log_deferred;
+        }
 
-        // copy into log_msg
-        void fill_log_msg(log_msg &msg)
+        // copy into log_msg and give the overflow text back to the pool
+        void fill_log_msg(log_msg &msg, const std::string& logger_name, string_pool& txt_pool)
         {
             msg.clear();
             msg.logger_name = logger_name;
-            msg.level = level;
-            msg.time = time;
+            msg.level = static_cast<level::level_enum>(level);
+            msg.time = log_clock::time_point(log_clock::duration(time));
             msg.thread_id = thread_id;
-            msg.raw << txt;
+            bool overflow = txt_size == overflow_size;
+            const char* txt = overflow ? overflow_txt->data() : txt_inline;
+            size_t size = overflow ? overflow_txt->size() : txt_size;
+            if (msg_type == async_msg_type::log_deferred)
+                fill_deferred(msg, txt, size);
+            else
+                msg.raw << fmt::StringRef(txt, size);
+            if (overflow)
+            {
+                txt_pool.release(overflow_txt);
+                txt_size = 0;
+            }
+        }
+
+    private:
+        // room for size bytes of text, inline when it fits
+        char* reserve_txt(size_t size, string_pool& txt_pool)
+        {
+            if (size <= sizeof(txt_inline))
+            {
+                txt_size = static_cast<uint16_t>(size);
+                return txt_inline;
+            }
+            txt_size = overflow_size;
+            overflow_txt = txt_pool.acquire();
+            overflow_txt->resize(size);
+            return &(*overflow_txt)[0];
+        }
+
+        // a bad format string cannot be reported to the caller anymore, it is logged instead
+        static void fill_deferred(log_msg& msg, const char* txt, size_t size)
+        {
+            try
+            {
+                format_deferred(txt, size, msg.raw);
+            }
+            catch (const fmt::FormatError& e)
+            {
+                msg.raw.clear();
+                msg.raw.write("formatting error while processing format string '{}': {}", deferred_format_string(txt), e.what());
+            }
         }
     };
 
+    static_assert(SPDLOG_ASYNC_INLINE_MSG_SIZE >= sizeof(std::string*) && SPDLOG_ASYNC_INLINE_MSG_SIZE < async_msg::overflow_size,
+                  "SPDLOG_ASYNC_INLINE_MSG_SIZE out of range");
+
 public:
 
     using item_type = async_msg;
-    using q_type = details::mpmc_bounded_queue<item_type>;
+    using q_type = details::async_queue<item_type>;
 
     using clock = std::chrono::steady_clock;
 
 
-    async_log_helper(formatter_ptr formatter,
+    async_log_helper(const std::string& logger_name,
+                     formatter_ptr formatter,
                      const std::vector<sink_ptr>& sinks,
                      size_t queue_size,
                      const async_overflow_policy overflow_policy = async_overflow_policy::block_retry,
                      const std::function<void()>& worker_warmup_cb = nullptr,
                      const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero(),
-                     const std::function<void()>& worker_teardown_cb = nullptr);
+                     const std::function<void()>& worker_teardown_cb = nullptr,
+                     const async_queue_type queue_type = async_queue_type::mpmc);
 
     void log(const details::log_msg& msg);
 
@@ -133,14 +265,32 @@ public:
 
     void flush();
 
+    // stop logging: later messages are discarded, the queued ones are written until the deadline.
+    // returns false if the worker missed the deadline, it then keeps the helper alive until done
+    // but no longer calls the sinks, and the sinks it is not stuck in are flushed by the caller.
+    // lost gets the messages discarded, except those the abandoned worker had not reached.
+    // later calls return the same outcome
+    bool shutdown(const clock::time_point& deadline, size_t& lost);
+
 
 private:
+    // a copy, as an abandoned worker can outlive the logger
+    const std::string _logger_name;
     formatter_ptr _formatter;
     std::vector<std::shared_ptr<sinks::sink>> _sinks;
 
     // queue of messages to log
     q_type _q;
 
+    // messages at or above _priority_level which did not fit in _q, drained first
+    mpmc_bounded_queue<item_type> _priority_q;
+
+    // messages drained by the last pop, reused by the worker thread
+    log_batch _batch;
+
+    // text of the messages too long for the queue slots
+    string_pool _txt_pool;
+
     bool _flush_requested;
 
     bool _terminate_requested;
@@ -152,6 +302,18 @@ private:
     // overflow policy
     const async_overflow_policy _overflow_policy;
 
+    const level::level_enum _priority_level;
+
+    // messages dropped on a full queue, by level. off included: a message can be logged at that level
+    std::atomic<size_t> _dropped[level::off + 1];
+
+    // worker side: dropped messages reported so far, by level
+    size_t _reported_dropped[level::off + 1];
+    log_clock::time_point _last_drop_report;
+
+    // a flush request was dropped by overrun_oldest
+    std::atomic<bool> _overrun_flush;
+
     // worker thread warmup callback - one can set thread priority, affinity, etc
     const std::function<void()> _worker_warmup_cb;
 
@@ -161,25 +323,90 @@ private:
     // worker thread teardown callback
     const std::function<void()> _worker_teardown_cb;
 
+    // blocking waits once spinning did not help
+    std::mutex _wait_mutex;
+    std::condition_variable _not_empty;
+    std::condition_variable _not_full;
+    std::atomic<bool> _worker_waiting;
+    std::atomic<int> _producers_waiting;
+
+    // set by shutdown(), _shutdown_deadline is written before
+    std::atomic<bool> _shutdown_requested;
+    clock::time_point _shutdown_deadline;
+
+    // messages discarded because of the shutdown
+    std::atomic<size_t> _lost;
+
+    // push_msg calls in progress, shutdown() waits for them before emptying the queues
+    std::atomic<int> _pushing;
+
+    // set once shutdown() gave up on the worker, which then leaves the sinks to the caller.
+    // _busy_sink is the sink the worker is in, the caller does not touch it
+    std::atomic<bool> _abandoned;
+    std::atomic<sinks::sink*> _busy_sink;
+
+    // serializes shutdown() calls
+    std::mutex _shutdown_mutex;
+
+    // guarded by _wait_mutex: the worker loop returned, and the reference an abandoned worker keeps on the helper
+    bool _worker_done;
+    std::shared_ptr<async_log_helper> _abandoned_self;
+    std::condition_variable _worker_stopped;
+
     // worker thread
     std::thread _worker_thread;
 
     void push_msg(async_msg&& new_msg);
 
+    // drop the oldest messages until new_msg fits
+    void overrun_oldest(async_msg&& new_msg);
+
+    static async_overflow_policy checked_policy(async_overflow_policy overflow_policy, async_queue_type queue_type);
+
     // throw last worker thread exception or if worker thread is not active
     void throw_if_bad_worker();
 
     // worker thread main loop
     void worker_loop();
 
-    // pop next message from the queue and process it. will set the last_pop to the pop time
+    // pop the next messages (up to SPDLOG_ASYNC_BATCH_SIZE) from the queue and process them.
+    // will set the last_pop to the pop time
     // return false if termination of the queue is required
     bool process_next_msg(log_clock::time_point& last_pop, log_clock::time_point& last_flush);
 
+    // add a dequeued message to the batch, or note the flush / terminate request
+    void process_msg(async_msg& incoming_async_msg);
+
+    // empty the queues at shutdown, counting their messages and the unreported drops as lost
+    void discard_queued();
+
     void handle_flush_interval(log_clock::time_point& now, log_clock::time_point& last_flush);
 
-    // sleep,yield or return immediatly using the time passed since last message as a hint
-    static void sleep_or_yield(const spdlog::log_clock::time_point& now, const log_clock::time_point& last_op_time);
+    // add the count of messages dropped since the last report to the batch, at most once per
+    // SPDLOG_ASYNC_DROP_REPORT_INTERVAL_MS while busy, and as soon as the queue is empty otherwise
+    void report_drops(const log_clock::time_point& now, bool queue_empty);
+
+    // block the worker until a message is pushed or the flush interval expires
+    void wait_for_msg(const log_clock::time_point& now, const log_clock::time_point& last_flush);
+
+    // marks the sink the worker is in, allowed is false once the worker was abandoned
+    struct sink_call
+    {
+        sink_call(async_log_helper& helper, sinks::sink* sink);
+        ~sink_call();
+        async_log_helper& _helper;
+        bool allowed;
+    };
+
+    // wake up the worker if it is blocked
+    void notify_worker();
+
+    // wake up clients blocked on a full queue, a dequeue makes room for one message
+    void notify_producers();
+
+    // spin or yield using the time passed since last operation as a hint
+    // return false once it is time to block instead
+    static bool spin_or_yield(const spdlog::log_clock::time_point& now, const log_clock::time_point& last_op_time);
 
 };
 }
@@ -189,33 +416,63 @@ private:
 // async_sink class implementation
 ///////////////////////////////////////////////////////////////////////////////
 inline spdlog::details::async_log_helper::async_log_helper(
+    const std::string& logger_name,
     formatter_ptr formatter,
     const std::vector<sink_ptr>& sinks,
     size_t queue_size,
     const async_overflow_policy overflow_policy,
     const std::function<void()>& worker_warmup_cb,
     const std::chrono::milliseconds& flush_interval_ms,
-    const std::function<void()>& worker_teardown_cb):
+    const std::function<void()>& worker_teardown_cb,
+    const async_queue_type queue_type):
+    _logger_name(logger_name),
     _formatter(formatter),
     _sinks(sinks),
-    _q(queue_size),
+    _q(queue_size, queue_type),
+    _priority_q(SPDLOG_ASYNC_PRIORITY_QUEUE_SIZE),
+    _txt_pool(queue_size + SPDLOG_ASYNC_BATCH_SIZE, 65536),
     _flush_requested(false),
     _terminate_requested(false),
-    _overflow_policy(overflow_policy),
+    _overflow_policy(checked_policy(overflow_policy, queue_type)),
+    _priority_level(overflow_policy == async_overflow_policy::discard_below_level ? level::warn : level::critical),
+    _dropped(),
+    _reported_dropped(),
+    _last_drop_report(details::os::now()),
+    _overrun_flush(false),
     _worker_warmup_cb(worker_warmup_cb),
     _flush_interval_ms(flush_interval_ms),
     _worker_teardown_cb(worker_teardown_cb),
+    _worker_waiting(false),
+    _producers_waiting(0),
+    _shutdown_requested(false),
+    _lost(0),
+    _pushing(0),
+    _abandoned(false),
+    _busy_sink(nullptr),
+    _worker_done(false),
     _worker_thread(&async_log_helper::worker_loop, this)
 {}
 
+inline spdlog::async_overflow_policy spdlog::details::async_log_helper::checked_policy(async_overflow_policy overflow_policy, async_queue_type queue_type)
+{
+    // dropping the oldest message takes it from the queue, which only the mpmc queue allows besides the worker
+    if (overflow_policy == async_overflow_policy::overrun_oldest && queue_type != async_queue_type::mpmc)
+        throw spdlog_ex("async overflow policy overrun_oldest requires the mpmc queue");
+    return overflow_policy;
+}
+
 // Send to the worker thread termination message(level=off)
-// and wait for it to finish gracefully
+// and wait for it to finish gracefully, unless shutdown() already stopped it
 inline spdlog::details::async_log_helper::~async_log_helper()
 {
     try
     {
-        push_msg(async_msg(async_msg_type::terminate));
-        _worker_thread.join();
+        if (!_shutdown_requested.load(std::memory_order_relaxed))
+        {
+            push_msg(async_msg(async_msg_type::terminate));
+            if (_worker_thread.joinable())
+                _worker_thread.join();
+        }
     }
     catch (...) // don't crash in destructor
     {}
@@ -225,26 +482,109 @@ inline spdlog::details::async_log_helper::~async_log_helper()
 //Try to push and block until succeeded (if the policy is not to discard when the queue is full)
 inline void spdlog::details::async_log_helper::log(const details::log_msg& msg)
 {
-    push_msg(async_msg(msg));
+    push_msg(async_msg(msg, _txt_pool));
 
 
 }
 
 inline void spdlog::details::async_log_helper::push_msg(details::async_log_helper::async_msg&& new_msg)
 {
+    // either shutdown() is seen here, or shutdown() waits for this push before emptying the queues
+    struct push_guard
+    {
+        explicit push_guard(std::atomic<int>& pushing) : _pushing(pushing)
+        {
+            _pushing.fetch_add(1, std::memory_order_seq_cst);
+        }
+        ~push_guard()
+        {
+            _pushing.fetch_sub(1, std::memory_order_release);
+        }
+        std::atomic<int>& _pushing;
+    } guard(_pushing);
+
+    if (_shutdown_requested.load(std::memory_order_seq_cst))
+    {
+        if (new_msg.is_log())
+            _lost.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
     throw_if_bad_worker();
-    if (!_q.enqueue(std::move(new_msg)) && _overflow_policy != async_overflow_policy::discard_log_msg)
+    if (_q.enqueue(std::move(new_msg)))
+    {
+        notify_worker();
+        return;
+    }
+
+    // flush and terminate are never dropped, they wait for room like with block_retry
+    if (new_msg.is_log())
+    {
+        auto msg_level = static_cast<level::level_enum>(new_msg.level);
+        if (msg_level >= _priority_level && _priority_q.enqueue(std::move(new_msg)))
+        {
+            notify_worker();
+            return;
+        }
+        switch (_overflow_policy)
+        {
+        case async_overflow_policy::discard_log_msg:
+        case async_overflow_policy::discard_below_level:
+            _dropped[msg_level].fetch_add(1, std::memory_order_relaxed);
+            return;
+        case async_overflow_policy::overrun_oldest:
+            overrun_oldest(std::move(new_msg));
+            return;
+        default:
+            break;
+        }
+    }
+
+    auto last_op_time = details::os::now();
+    while (spin_or_yield(details::os::now(), last_op_time))
+    {
+        if (_q.enqueue(std::move(new_msg)))
+        {
+            notify_worker();
+            return;
+        }
+    }
+
+    // the worker is behind, wait until it makes room
+    ++_producers_waiting;
     {
-        auto last_op_time = details::os::now();
-        auto now = last_op_time;
-        do
+        std::unique_lock<std::mutex> lock(_wait_mutex);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        while (!_q.enqueue(std::move(new_msg)))
         {
-            now = details::os::now();
-            sleep_or_yield(now, last_op_time);
+            // the worker may be gone, shutdown() wakes up the waiting clients
+            if (_shutdown_requested.load(std::memory_order_relaxed))
+            {
+                if (new_msg.is_log())
+                    _lost.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            _not_full.wait(lock);
         }
-        while (!_q.enqueue(std::move(new_msg)));
     }
+    --_producers_waiting;
+    notify_worker();
+}
 
+inline void spdlog::details::async_log_helper::overrun_oldest(async_msg&& new_msg)
+{
+    async_msg oldest;
+    do
+    {
+        if (_q.dequeue(oldest))
+        {
+            if (oldest.is_log())
+                _dropped[oldest.level].fetch_add(1, std::memory_order_relaxed);
+            else // a flush, terminate is always the last message
+                _overrun_flush.store(true, std::memory_order_relaxed);
+        }
+    }
+    while (!_q.enqueue(std::move(new_msg)));
+    notify_worker();
 }
 
 inline void spdlog::details::async_log_helper::flush()
@@ -252,6 +592,69 @@ inline void spdlog::details::async_log_helper::flush()
     push_msg(async_msg(async_msg_type::flush));
 }
 
+inline bool spdlog::details::async_log_helper::shutdown(const clock::time_point& deadline, size_t& lost)
+{
+    std::lock_guard<std::mutex> shutdown_lock(_shutdown_mutex);
+    if (!_worker_thread.joinable())
+    {
+        // shut down already
+        lost = _lost.load(std::memory_order_relaxed);
+        return !_abandoned.load(std::memory_order_relaxed);
+    }
+
+    _shutdown_deadline = deadline;
+    _shutdown_requested.store(true, std::memory_order_seq_cst);
+    std::unique_lock<std::mutex> lock(_wait_mutex);
+    _not_empty.notify_one();
+    _not_full.notify_all();
+    auto worker_done = [this]()
+    {
+        return _worker_done;
+    };
+    if (!_worker_stopped.wait_until(lock, deadline, worker_done))
+    {
+        _abandoned_self = shared_from_this();
+        lock.unlock();
+        // pairs with sink_call: either the worker sees the flag, or the sink it is in is left alone
+        _abandoned.store(true, std::memory_order_seq_cst);
+        auto busy = _busy_sink.load(std::memory_order_seq_cst);
+        for (auto& s : _sinks)
+        {
+            if (s.get() == busy)
+                continue;
+            try
+            {
+                s->flush();
+            }
+            catch (...)
+            {}
+        }
+        _worker_thread.detach();
+        lost = _lost.load(std::memory_order_relaxed);
+        return false;
+    }
+    lock.unlock();
+    _worker_thread.join();
+    // messages pushed while the worker was exiting
+    while (_pushing.load(std::memory_order_acquire) != 0)
+        std::this_thread::yield();
+    discard_queued();
+    lost = _lost.load(std::memory_order_relaxed);
+    return true;
+}
+
+inline spdlog::details::async_log_helper::sink_call::sink_call(async_log_helper& helper, sinks::sink* sink):
+    _helper(helper)
+{
+    _helper._busy_sink.store(sink, std::memory_order_seq_cst);
+    allowed = !_helper._abandoned.load(std::memory_order_seq_cst);
+}
+
+inline spdlog::details::async_log_helper::sink_call::~sink_call()
+{
+    _helper._busy_sink.store(nullptr, std::memory_order_release);
+}
+
 inline void spdlog::details::async_log_helper::worker_loop()
 {
     try
@@ -270,6 +673,15 @@ inline void spdlog::details::async_log_helper::worker_loop()
     {
         _last_workerthread_ex = std::make_shared<spdlog_ex>("async_logger worker thread exception");
     }
+
+    // once shutdown() gave up on this thread, it may hold the last reference to the helper
+    std::shared_ptr<async_log_helper> self;
+    {
+        std::lock_guard<std::mutex> lock(_wait_mutex);
+        _worker_done = true;
+        self = std::move(_abandoned_self);
+        _worker_stopped.notify_all();
+    }
 }
 
 // process next message in the queue
@@ -278,28 +690,44 @@ inline bool spdlog::details::async_log_helper::process_next_msg(log_clock::time_
 {
 
     async_msg incoming_async_msg;
-    log_msg incoming_log_msg;
+    size_t popped = 0;
 
-    if (_q.dequeue(incoming_async_msg))
+    if (_shutdown_requested.load(std::memory_order_acquire) && clock::now() >= _shutdown_deadline)
     {
-        last_pop = details::os::now();
-        switch (incoming_async_msg.msg_type)
-        {
-        case async_msg_type::flush:
-            _flush_requested = true;
-            break;
+        discard_queued();
+        return false;
+    }
 
-        case async_msg_type::terminate:
-            _flush_requested = true;
-            _terminate_requested = true;
-            break;
+    _batch.clear();
+    // the priority queue only gets messages while the main one is full, it is checked once per batch
+    while (popped < SPDLOG_ASYNC_BATCH_SIZE && _priority_q.dequeue(incoming_async_msg))
+    {
+        ++popped;
+        process_msg(incoming_async_msg);
+    }
+    while (popped < SPDLOG_ASYNC_BATCH_SIZE && _q.dequeue(incoming_async_msg))
+    {
+        ++popped;
+        notify_producers();
+        process_msg(incoming_async_msg);
+    }
 
-        default:
-            incoming_async_msg.fill_log_msg(incoming_log_msg);
-            _formatter->format(incoming_log_msg);
-            for (auto &s : _sinks)
-                s->log(incoming_log_msg);
+    auto now = details::os::now();
+    report_drops(now, popped == 0);
+    if (!_batch.empty())
+    {
+        for (auto &s : _sinks)
+        {
+            sink_call call(*this, s.get());
+            if (!call.allowed)
+                return false;
+            s->log_batch(_batch);
         }
+    }
+
+    if (popped != 0)
+    {
+        last_pop = now;
         return true;
     }
 
@@ -307,57 +735,179 @@ inline bool spdlog::details::async_log_helper::process_next_msg(log_clock::time_
     // This is the only place where the queue can terminate or flush to avoid losing messages already in the queue
     else
     {
-        auto now = details::os::now();
+        // drained before the shutdown deadline
+        if (_shutdown_requested.load(std::memory_order_acquire))
+            _flush_requested = _terminate_requested = true;
         handle_flush_interval(now, last_flush);
-        sleep_or_yield(now, last_pop);
-        return !_terminate_requested;
+        if (_terminate_requested)
+            return false;
+        if (!spin_or_yield(now, last_pop))
+            wait_for_msg(now, last_flush);
+        return true;
 
     }
 }
 
+// flush and terminate only take effect once the queue is empty, so the batch can go past them
+inline void spdlog::details::async_log_helper::process_msg(async_msg& incoming_async_msg)
+{
+    switch (incoming_async_msg.msg_type)
+    {
+    case async_msg_type::flush:
+        _flush_requested = true;
+        break;
+
+    case async_msg_type::terminate:
+        _flush_requested = true;
+        _terminate_requested = true;
+        break;
+
+    default:
+        log_msg& incoming_log_msg = _batch.next();
+        incoming_async_msg.fill_log_msg(incoming_log_msg, _logger_name, _txt_pool);
+        _formatter->format(incoming_log_msg);
+        _batch.commit();
+    }
+}
+
+inline void spdlog::details::async_log_helper::discard_queued()
+{
+    async_msg discarded;
+    size_t lost = 0;
+    while (_priority_q.dequeue(discarded))
+        lost += discarded.is_log();
+    while (_q.dequeue(discarded))
+        lost += discarded.is_log();
+    for (int i = 0; i <= level::off; ++i)
+    {
+        auto count = _dropped[i].load(std::memory_order_relaxed);
+        lost += count - _reported_dropped[i];
+        _reported_dropped[i] = count;
+    }
+    _lost.fetch_add(lost, std::memory_order_relaxed);
+}
+
 // flush all sinks if _flush_interval_ms has expired
 inline void spdlog::details::async_log_helper::handle_flush_interval(log_clock::time_point& now, log_clock::time_point& last_flush)
 {
+    if (_overrun_flush.load(std::memory_order_relaxed) && _overrun_flush.exchange(false))
+        _flush_requested = true;
     auto should_flush = _flush_requested || (_flush_interval_ms != std::chrono::milliseconds::zero() && now - last_flush >= _flush_interval_ms);
     if (should_flush)
     {
         for (auto &s : _sinks)
+        {
+            sink_call call(*this, s.get());
+            if (!call.allowed)
+                return;
             s->flush();
+        }
         now = last_flush = details::os::now();
         _flush_requested = false;
     }
 }
 
+inline void spdlog::details::async_log_helper::report_drops(const log_clock::time_point& now, bool queue_empty)
+{
+    if (!queue_empty && now - _last_drop_report < std::chrono::milliseconds(SPDLOG_ASYNC_DROP_REPORT_INTERVAL_MS))
+        return;
+
+    size_t dropped[level::off + 1];
+    size_t total = 0;
+    for (int i = 0; i <= level::off; ++i)
+    {
+        auto count = _dropped[i].load(std::memory_order_relaxed);
+        dropped[i] = count - _reported_dropped[i];
+        _reported_dropped[i] = count;
+        total += dropped[i];
+    }
+    if (total == 0)
+        return;
+    _last_drop_report = now;
+
+    log_msg& report = _batch.next();
+    report.clear();
+    report.logger_name = _logger_name;
+    report.level = level::warn;
+    report.time = now;
+    report.thread_id = details::os::thread_id();
+    report.raw << "async logger dropped " << total << " messages on a full queue (";
+    const char* separator = "";
+    for (int i = 0; i <= level::off; ++i)
+    {
+        if (dropped[i] == 0)
+            continue;
+        report.raw << separator << level::to_str(static_cast<level::level_enum>(i)) << ": " << dropped[i];
+        separator = ", ";
+    }
+    report.raw << ')';
+    _formatter->format(report);
+    _batch.commit();
+}
+
 inline void spdlog::details::async_log_helper::set_formatter(formatter_ptr msg_formatter)
 {
     _formatter = msg_formatter;
 }
 
 
-// spin, yield or sleep. use the time passed since last message as a hint
-inline void spdlog::details::async_log_helper::sleep_or_yield(const spdlog::log_clock::time_point& now, const spdlog::log_clock::time_point& last_op_time)
+inline void spdlog::details::async_log_helper::wait_for_msg(const log_clock::time_point& now, const log_clock::time_point& last_flush)
+{
+    std::unique_lock<std::mutex> lock(_wait_mutex);
+    _worker_waiting.store(true, std::memory_order_relaxed);
+    // pairs with the fence in notify_worker: either the pusher sees the flag or we see its message
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_q.is_empty() && _priority_q.is_empty() && !_shutdown_requested.load(std::memory_order_relaxed))
+    {
+        if (_flush_interval_ms == std::chrono::milliseconds::zero())
+            _not_empty.wait(lock);
+        else if (now - last_flush < _flush_interval_ms)
+            _not_empty.wait_for(lock, _flush_interval_ms - (now - last_flush));
+    }
+    _worker_waiting.store(false, std::memory_order_relaxed);
+}
+
+inline void spdlog::details::async_log_helper::notify_worker()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_worker_waiting.load(std::memory_order_relaxed))
+    {
+        // taking the lock makes sure the worker is already waiting, or has not checked the queue yet
+        std::lock_guard<std::mutex> lock(_wait_mutex);
+        _not_empty.notify_one();
+    }
+}
+
+inline void spdlog::details::async_log_helper::notify_producers()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_producers_waiting.load(std::memory_order_relaxed) != 0)
+    {
+        std::lock_guard<std::mutex> lock(_wait_mutex);
+        // with a queue per thread, the room is only for the client owning the dequeued message
+        if (_q.type() == async_queue_type::per_thread)
+            _not_full.notify_all();
+        else
+            _not_full.notify_one();
+    }
+}
+
+// spin upto 50 micros, then yield upto 100 micros. use the time passed since last operation as a hint
+inline bool spdlog::details::async_log_helper::spin_or_yield(const spdlog::log_clock::time_point& now, const spdlog::log_clock::time_point& last_op_time)
 {
-    using namespace std::this_thread;
-    using std::chrono::milliseconds;
     using std::chrono::microseconds;
 
     auto time_since_op = now - last_op_time;
 
-    // spin upto 50 micros
     if (time_since_op <= microseconds(50))
-        return;
+        return true;
 
-    // yield upto 150 micros
     if (time_since_op <= microseconds(100))
-        return yield();
-
-
-    // sleep for 20 ms upto 200 ms
-    if (time_since_op <= milliseconds(200))
-        return sleep_for(milliseconds(20));
-
-    // sleep for 200 ms
-    return sleep_for(milliseconds(200));
+    {
+        std::this_thread::yield();
+        return true;
+    }
+    return false;
 }
 
 // throw if the worker thread threw an exception or not active
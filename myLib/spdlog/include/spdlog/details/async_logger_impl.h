@@ -24,10 +24,23 @@ inline spdlog::async_logger::async_logger(const std::string& logger_name,
         const  async_overflow_policy overflow_policy,
         const std::function<void()>& worker_warmup_cb,
         const std::chrono::milliseconds& flush_interval_ms,
-        const std::function<void()>& worker_teardown_cb) :
-    logger(logger_name, begin, end),
-    _async_log_helper(new details::async_log_helper(_formatter, _sinks, queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms, worker_teardown_cb))
+        const std::function<void()>& worker_teardown_cb,
+        const async_queue_type queue_type,
+        const async_workers workers) :
+    logger(logger_name, begin, end)
 {
+    if (workers == async_workers::per_sink)
+    {
+        // blocking on the full queue of a slow sink would hold back the other sinks too
+        if (overflow_policy == async_overflow_policy::block_retry)
+            throw spdlog_ex("async_workers::per_sink requires a non blocking overflow policy");
+        for (auto& sink : _sinks)
+            _async_log_helpers.emplace_back(new details::async_log_helper(_name, _formatter, { sink }, queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms, worker_teardown_cb, queue_type));
+    }
+    else
+    {
+        _async_log_helpers.emplace_back(new details::async_log_helper(_name, _formatter, _sinks, queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms, worker_teardown_cb, queue_type));
+    }
 }
 
 inline spdlog::async_logger::async_logger(const std::string& logger_name,
@@ -36,8 +49,10 @@ inline spdlog::async_logger::async_logger(const std::string& logger_name,
         const  async_overflow_policy overflow_policy,
         const std::function<void()>& worker_warmup_cb,
         const std::chrono::milliseconds& flush_interval_ms,
-        const std::function<void()>& worker_teardown_cb) :
-    async_logger(logger_name, sinks.begin(), sinks.end(), queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms, worker_teardown_cb) {}
+        const std::function<void()>& worker_teardown_cb,
+        const async_queue_type queue_type,
+        const async_workers workers) :
+    async_logger(logger_name, sinks.begin(), sinks.end(), queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms, worker_teardown_cb, queue_type, workers) {}
 
 inline spdlog::async_logger::async_logger(const std::string& logger_name,
         sink_ptr single_sink,
@@ -45,33 +60,57 @@ inline spdlog::async_logger::async_logger(const std::string& logger_name,
         const  async_overflow_policy overflow_policy,
         const std::function<void()>& worker_warmup_cb,
         const std::chrono::milliseconds& flush_interval_ms,
-        const std::function<void()>& worker_teardown_cb) :
+        const std::function<void()>& worker_teardown_cb,
+        const async_queue_type queue_type,
+        const async_workers workers) :
     async_logger(logger_name,
 {
     single_sink
-}, queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms, worker_teardown_cb) {}
+}, queue_size, overflow_policy, worker_warmup_cb, flush_interval_ms, worker_teardown_cb, queue_type, workers) {}
 
 
+inline void spdlog::async_logger::set_deferred_formatting(bool deferred)
+{
+    _deferred_formatting = deferred;
+}
+
+inline spdlog::shutdown_report spdlog::async_logger::shutdown(const std::chrono::steady_clock::time_point& deadline)
+{
+    shutdown_report report;
+    for (auto& helper : _async_log_helpers)
+    {
+        size_t lost = 0;
+        if (!helper->shutdown(deadline, lost))
+            ++report.workers_abandoned;
+        report.lost += lost;
+    }
+    return report;
+}
+
 inline void spdlog::async_logger::flush()
 {
 
-    _async_log_helper->flush();
+    for (auto& helper : _async_log_helpers)
+        helper->flush();
 }
 
 inline void spdlog::async_logger::_set_formatter(spdlog::formatter_ptr msg_formatter)
 {
     _formatter = msg_formatter;
-    _async_log_helper->set_formatter(_formatter);
+    for (auto& helper : _async_log_helpers)
+        helper->set_formatter(_formatter);
 }
 
 inline void spdlog::async_logger::_set_pattern(const std::string& pattern)
 {
     _formatter = std::make_shared<pattern_formatter>(pattern);
-    _async_log_helper->set_formatter(_formatter);
+    for (auto& helper : _async_log_helpers)
+        helper->set_formatter(_formatter);
 }
 
 
 inline void spdlog::async_logger::_log_msg(details::log_msg& msg)
 {
-    _async_log_helper->log(msg);
+    for (auto& helper : _async_log_helpers)
+        helper->log(msg);
 }
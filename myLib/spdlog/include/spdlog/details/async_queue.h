@@ -0,0 +1,270 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Queues the async logger can use between the logging threads and its worker thread,
+// see async_queue_type in common.h.
+// All of them have a single consumer: the worker thread is the only one to call dequeue() and is_empty().
+
+#include <spdlog/common.h>
+#include <spdlog/details/mpmc_bounded_q.h>
+#include <spdlog/details/mpsc_bounded_q.h>
+#include <spdlog/details/spsc_bounded_q.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace spdlog
+{
+namespace details
+{
+
+// A single producer queue for each thread pushing to it, created on the first push of the thread.
+// The consumer drains them round robin, so messages of one thread keep their order.
+// The queue of a thread is released once the thread exited and the consumer emptied it.
+template<typename T>
+class per_thread_queue
+{
+public:
+    using item_type = T;
+
+    per_thread_queue(size_t buffer_size) :
+        _buffer_size(buffer_size),
+        _id(next_id()),
+        _version(0),
+        _seen_version(0),
+        _next(0)
+    {
+        //queue size must be power of two
+        if(!((buffer_size >= 2) && ((buffer_size & (buffer_size - 1)) == 0)))
+            throw spdlog_ex("async logger queue size must be power of two");
+    }
+
+    ~per_thread_queue()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto& r : _rings)
+            r->detached.store(true, std::memory_order_relaxed);
+    }
+
+    per_thread_queue(const per_thread_queue&) = delete;
+    per_thread_queue& operator=(const per_thread_queue&) = delete;
+
+    bool enqueue(T&& data)
+    {
+        return local_ring().queue.enqueue(std::move(data));
+    }
+
+    bool dequeue(T& data)
+    {
+        refresh();
+        bool orphans = false;
+        for (size_t i = 0; i < _consumer_rings.size(); ++i)
+        {
+            auto& r = *_consumer_rings[_next];
+            if (r.queue.dequeue(data))
+                return true;
+            orphans |= r.orphaned.load(std::memory_order_relaxed);
+            if (++_next == _consumer_rings.size())
+                _next = 0;
+        }
+        if (orphans)
+            release_orphans();
+        return false;
+    }
+
+    bool is_empty()
+    {
+        refresh();
+        for (auto& r : _consumer_rings)
+        {
+            if (!r->queue.is_empty())
+                return false;
+        }
+        return true;
+    }
+
+private:
+    struct ring
+    {
+        explicit ring(size_t buffer_size) :queue(buffer_size), orphaned(false), detached(false) {}
+
+        spsc_bounded_queue<T> queue;
+        // the producer thread exited
+        std::atomic<bool> orphaned;
+        // the per_thread_queue is gone
+        std::atomic<bool> detached;
+    };
+    using ring_ptr = std::shared_ptr<ring>;
+
+    // the rings of the calling thread, by per_thread_queue id
+    struct thread_rings
+    {
+        std::unordered_map<size_t, ring_ptr> rings;
+        size_t last_id = 0;
+        ring* last = nullptr;
+
+        ~thread_rings()
+        {
+            for (auto& r : rings)
+                r.second->orphaned.store(true, std::memory_order_release);
+        }
+    };
+
+    static size_t next_id()
+    {
+        static std::atomic<size_t> s_id(0);
+        return ++s_id;
+    }
+
+    ring& local_ring()
+    {
+        static thread_local thread_rings t_rings;
+        if (t_rings.last_id == _id)
+            return *t_rings.last;
+
+        auto found = t_rings.rings.find(_id);
+        if (found == t_rings.rings.end())
+        {
+            // forget the rings of queues destroyed since
+            for (auto it = t_rings.rings.begin(); it != t_rings.rings.end();)
+            {
+                if (it->second->detached.load(std::memory_order_relaxed))
+                    it = t_rings.rings.erase(it);
+                else
+                    ++it;
+            }
+            auto r = std::make_shared<ring>(_buffer_size);
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _rings.push_back(r);
+                _version.fetch_add(1, std::memory_order_release);
+            }
+            found = t_rings.rings.emplace(_id, r).first;
+        }
+        t_rings.last_id = _id;
+        t_rings.last = found->second.get();
+        return *t_rings.last;
+    }
+
+    // pick up the rings of threads which started pushing since last time
+    void refresh()
+    {
+        if (_version.load(std::memory_order_acquire) == _seen_version)
+            return;
+        std::lock_guard<std::mutex> lock(_mutex);
+        _consumer_rings = _rings;
+        _seen_version = _version.load(std::memory_order_relaxed);
+        _next = 0;
+    }
+
+    void release_orphans()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto released = std::remove_if(_rings.begin(), _rings.end(), [](const ring_ptr& r)
+        {
+            return r->orphaned.load(std::memory_order_acquire) && r->queue.is_empty();
+        });
+        if (released == _rings.end())
+            return;
+        _rings.erase(released, _rings.end());
+        _version.fetch_add(1, std::memory_order_release);
+    }
+
+    const size_t _buffer_size;
+    const size_t _id;
+
+    // rings of all the producer threads, guarded by _mutex
+    std::mutex _mutex;
+    std::vector<ring_ptr> _rings;
+    std::atomic<unsigned> _version;
+
+    // consumer side copy of _rings
+    std::vector<ring_ptr> _consumer_rings;
+    unsigned _seen_version;
+    size_t _next;
+};
+
+// The queue selected by async_queue_type
+template<typename T>
+class async_queue
+{
+public:
+    using item_type = T;
+
+    async_queue(size_t buffer_size, async_queue_type type) :_type(type)
+    {
+        switch (_type)
+        {
+        case async_queue_type::mpsc:
+            _mpsc.reset(new mpsc_bounded_queue<T>(buffer_size));
+            break;
+        case async_queue_type::per_thread:
+            _per_thread.reset(new per_thread_queue<T>(buffer_size));
+            break;
+        default:
+            _mpmc.reset(new mpmc_bounded_queue<T>(buffer_size));
+        }
+    }
+
+    async_queue_type type() const
+    {
+        return _type;
+    }
+
+    bool enqueue(T&& data)
+    {
+        switch (_type)
+        {
+        case async_queue_type::mpsc:
+            return _mpsc->enqueue(std::move(data));
+        case async_queue_type::per_thread:
+            return _per_thread->enqueue(std::move(data));
+        default:
+            return _mpmc->enqueue(std::move(data));
+        }
+    }
+
+    bool dequeue(T& data)
+    {
+        switch (_type)
+        {
+        case async_queue_type::mpsc:
+            return _mpsc->dequeue(data);
+        case async_queue_type::per_thread:
+            return _per_thread->dequeue(data);
+        default:
+            return _mpmc->dequeue(data);
+        }
+    }
+
+    bool is_empty()
+    {
+        switch (_type)
+        {
+        case async_queue_type::mpsc:
+            return _mpsc->is_empty();
+        case async_queue_type::per_thread:
+            return _per_thread->is_empty();
+        default:
+            return _mpmc->is_empty();
+        }
+    }
+
+private:
+    const async_queue_type _type;
+    std::unique_ptr<mpmc_bounded_queue<T>> _mpmc;
+    std::unique_ptr<mpsc_bounded_queue<T>> _mpsc;
+    std::unique_ptr<per_thread_queue<T>> _per_thread;
+};
+
+} // ns details
+} // ns spdlog
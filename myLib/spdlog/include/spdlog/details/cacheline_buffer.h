@@ -0,0 +1,58 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Fixed size array of default constructed items, starting on a cache line boundary,
+// so items sized in whole cache lines never straddle two more lines than needed.
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace spdlog
+{
+namespace details
+{
+
+static const size_t cacheline_size = 64;
+
+template<typename T>
+class cacheline_buffer
+{
+public:
+    explicit cacheline_buffer(size_t size) :
+        _raw(new char[size * sizeof(T) + cacheline_size]),
+        _size(size)
+    {
+        auto address = reinterpret_cast<uintptr_t>(_raw);
+        _items = reinterpret_cast<T*>((address + cacheline_size - 1) & ~(uintptr_t)(cacheline_size - 1));
+        for (size_t i = 0; i != _size; ++i)
+            new (&_items[i]) T();
+    }
+
+    ~cacheline_buffer()
+    {
+        for (size_t i = 0; i != _size; ++i)
+            _items[i].~T();
+        delete [] _raw;
+    }
+
+    cacheline_buffer(const cacheline_buffer&) = delete;
+    cacheline_buffer& operator=(const cacheline_buffer&) = delete;
+
+    T& operator[](size_t i) const
+    {
+        return _items[i];
+    }
+
+private:
+    char* const _raw;
+    const size_t _size;
+    T* _items;
+};
+
+}
+}
@@ -0,0 +1,146 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Deferred formatting: the logging thread copies the format string and the arguments
+// of a message, and the text is formatted later by the async worker.
+//
+// The copy is flat: the argument types, the argument values, the format string, the strings
+// the arguments refer to and the text appended to the message with operator<<.
+// Only numbers, strings and pointers are copied. Nothing the copy refers to has to outlive the call,
+// so format strings built at runtime are deferred as safely as literals.
+
+#include <spdlog/details/format.h>
+#include <spdlog/details/log_msg.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace spdlog
+{
+namespace details
+{
+
+using fmt_value = fmt::internal::Value;
+
+inline fmt_value::Type deferred_arg_type(uint64_t types, unsigned index)
+{
+    return static_cast<fmt_value::Type>((types >> (index * 4)) & 0xf);
+}
+
+inline unsigned deferred_arg_count(uint64_t types)
+{
+    unsigned count = 0;
+    while (count < fmt::ArgList::MAX_PACKED_ARGS && deferred_arg_type(types, count) != fmt_value::NONE)
+        ++count;
+    return count;
+}
+
+// true if the arguments can be copied. sets the size of the C strings
+inline bool prepare_deferred_args(uint64_t types, fmt_value* values, unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+    {
+        switch (deferred_arg_type(types, i))
+        {
+        case fmt_value::CSTRING:
+            if (!values[i].string.value)
+                return false;
+            values[i].string.size = std::strlen(values[i].string.value);
+            break;
+        case fmt_value::NONE:
+        case fmt_value::NAMED_ARG:
+        case fmt_value::WSTRING:
+        case fmt_value::CUSTOM:
+            return false;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+// bytes of the string copied for an argument, C strings keep their terminating zero
+inline size_t deferred_string_size(uint64_t types, const fmt_value* values, unsigned index)
+{
+    switch (deferred_arg_type(types, index))
+    {
+    case fmt_value::CSTRING:
+        return values[index].string.size + 1;
+    case fmt_value::STRING:
+        return values[index].string.size;
+    default:
+        return 0;
+    }
+}
+
+inline size_t deferred_size(const log_msg& msg)
+{
+    unsigned count = deferred_arg_count(msg.fmt_types);
+    size_t size = sizeof(msg.fmt_types) + count * sizeof(fmt_value) + std::strlen(msg.fmt_str) + 1 + msg.raw.size();
+    for (unsigned i = 0; i < count; ++i)
+        size += deferred_string_size(msg.fmt_types, msg.fmt_values, i);
+    return size;
+}
+
+// dest must have deferred_size(msg) bytes
+inline void write_deferred(const log_msg& msg, char* dest)
+{
+    unsigned count = deferred_arg_count(msg.fmt_types);
+    std::memcpy(dest, &msg.fmt_types, sizeof(msg.fmt_types));
+    dest += sizeof(msg.fmt_types);
+    std::memcpy(dest, msg.fmt_values, count * sizeof(fmt_value));
+    dest += count * sizeof(fmt_value);
+    // with its terminating zero
+    auto fmt_size = std::strlen(msg.fmt_str) + 1;
+    std::memcpy(dest, msg.fmt_str, fmt_size);
+    dest += fmt_size;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        auto string_size = deferred_string_size(msg.fmt_types, msg.fmt_values, i);
+        std::memcpy(dest, msg.fmt_values[i].string.value, string_size);
+        dest += string_size;
+    }
+    std::memcpy(dest, msg.raw.data(), msg.raw.size());
+}
+
+// the format string in a copy made by write_deferred
+inline const char* deferred_format_string(const char* src)
+{
+    uint64_t types;
+    std::memcpy(&types, src, sizeof(types));
+    return src + sizeof(types) + deferred_arg_count(types) * sizeof(fmt_value);
+}
+
+// format a copy made by write_deferred. throws fmt::FormatError
+inline void format_deferred(const char* src, size_t size, fmt::MemoryWriter& out)
+{
+    const char* end = src + size;
+    uint64_t types;
+    fmt_value values[fmt::ArgList::MAX_PACKED_ARGS];
+    std::memcpy(&types, src, sizeof(types));
+    src += sizeof(types);
+    unsigned count = deferred_arg_count(types);
+    std::memcpy(values, src, count * sizeof(fmt_value));
+    src += count * sizeof(fmt_value);
+    const char* fmt_str = src;
+    src += std::strlen(fmt_str) + 1;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        auto string_size = deferred_string_size(types, values, i);
+        if (string_size != 0)
+        {
+            values[i].string.value = src;
+            src += string_size;
+        }
+    }
+    out.write(fmt_str, fmt::ArgList(types, values));
+    out << fmt::StringRef(src, end - src);
+}
+
+}
+}
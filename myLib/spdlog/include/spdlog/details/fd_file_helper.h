@@ -0,0 +1,309 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Helper class for fd_file_sink (posix only)
+// Owns the file descriptor and a page aligned buffer taking the messages. The buffer is handed
+// to the kernel with one write() once full, or together with a message too big for it with one writev().
+// Calls fdatasync according to the durability policy on write() and flush(), and counts the bytes and syscalls.
+// When failing to open a file, retry several times(5) with small delay between the tries(10 ms)
+// Throw spdlog_ex exception on errors
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <spdlog/common.h>
+#include <spdlog/details/os.h>
+#include <spdlog/details/log_msg.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifndef SPDLOG_FD_BUFFER_SIZE
+#define SPDLOG_FD_BUFFER_SIZE (256 * 1024)
+#endif
+
+namespace spdlog
+{
+namespace details
+{
+
+class fd_file_helper
+{
+
+public:
+    const int open_tries = 5;
+    const int open_interval = 10;
+    static const size_t buffer_alignment = 4096;
+
+    explicit fd_file_helper(const durability_policy& durability = durability_policy(), size_t buffer_size = SPDLOG_FD_BUFFER_SIZE) :
+        _fd(-1),
+        _durability(durability),
+        _buffer(nullptr),
+        _capacity(buffer_size ? buffer_size : 1),
+        _used(0),
+        _file_size(0),
+        _unsynced(0),
+        _last_sync(std::chrono::steady_clock::now())
+    {
+        void* buffer = nullptr;
+        if (posix_memalign(&buffer, buffer_alignment, _capacity) != 0)
+            throw spdlog_ex("fd_file_helper: failed allocating buffer of " + std::to_string(_capacity) + " bytes");
+        _buffer = static_cast<char*>(buffer);
+    }
+
+    fd_file_helper(const fd_file_helper&) = delete;
+    fd_file_helper& operator=(const fd_file_helper&) = delete;
+
+    ~fd_file_helper()
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+        std::free(_buffer);
+    }
+
+
+    void open(const filename_t& fname, bool truncate = false)
+    {
+        close();
+        int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+        _filename = fname;
+        for (int tries = 0; tries < open_tries; ++tries)
+        {
+            _fd = ::open(fname.c_str(), flags, 0644);
+            if (_fd != -1)
+            {
+                struct stat st;
+                _file_size = ::fstat(_fd, &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+                _unsynced = 0;
+                _last_sync = std::chrono::steady_clock::now();
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(open_interval));
+        }
+
+        throw spdlog_ex("Failed opening file " + os::filename_to_str(_filename) + " for writing");
+    }
+
+    void reopen(bool truncate)
+    {
+        if (_filename.empty())
+            throw spdlog_ex("Failed re opening file - was not opened before");
+        open(_filename, truncate);
+    }
+
+    // hand the buffered messages to the kernel, and sync them if the durability policy says so
+    void flush()
+    {
+        if (_used)
+            write_buffer(0);
+        if (sync_due())
+            sync();
+    }
+
+    // hand the buffered messages to the kernel and wait for them to be on disk
+    void sync()
+    {
+        if (_used)
+            write_buffer(0);
+        if (_fd == -1)
+            return;
+#ifdef __APPLE__
+        int rv = ::fsync(_fd);
+#else
+        int rv = ::fdatasync(_fd);
+#endif
+        ++_stats.sync_calls;
+        _unsynced = 0;
+        _last_sync = std::chrono::steady_clock::now();
+        if (rv != 0)
+            throw spdlog_ex("Failed syncing file " + os::filename_to_str(_filename) + ": " + std::strerror(errno));
+    }
+
+    void close()
+    {
+        if (_fd == -1)
+            return;
+        try
+        {
+            if (_durability.sync_bytes || _durability.sync_interval.count())
+                sync();
+            else
+                flush();
+        }
+        catch (...)
+        {
+            ::close(_fd);
+            _fd = -1;
+            _used = 0;
+            throw;
+        }
+        ::close(_fd);
+        _fd = -1;
+    }
+
+    void write(const log_msg& msg)
+    {
+        write(msg.formatted.data(), msg.formatted.size());
+    }
+
+    void write(const char* data, size_t size)
+    {
+        if (_fd == -1)
+            throw spdlog_ex("Failed writing to closed file " + os::filename_to_str(_filename));
+
+        if (size <= _capacity - _used)
+        {
+            std::memcpy(_buffer + _used, data, size);
+            _used += size;
+        }
+        else if (size < _capacity)
+        {
+            write_buffer(0);
+            std::memcpy(_buffer, data, size);
+            _used = size;
+        }
+        else
+        {
+            // too big for the buffer: write both at once
+            writev_fully(data, size);
+        }
+        _file_size += size;
+        _unsynced += size;
+
+        if (sync_due())
+            sync();
+    }
+
+    // size of the file, including the buffered messages
+    size_t size() const
+    {
+        if (_fd == -1)
+            throw spdlog_ex("Cannot use size() on closed file " + os::filename_to_str(_filename));
+        return _file_size;
+    }
+
+    const fd_file_stats& stats() const
+    {
+        return _stats;
+    }
+
+    const filename_t& filename() const
+    {
+        return _filename;
+    }
+
+private:
+    bool sync_due() const
+    {
+        if (!_unsynced)
+            return false;
+        if (_durability.sync_bytes && _unsynced >= _durability.sync_bytes)
+            return true;
+        return _durability.sync_interval.count() && std::chrono::steady_clock::now() - _last_sync >= _durability.sync_interval;
+    }
+
+    // on return or on failure, data and size are what was not written yet
+    void write_fully(const char*& data, size_t& size)
+    {
+        while (size)
+        {
+            ssize_t written = ::write(_fd, data, size);
+            ++_stats.write_calls;
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                throw spdlog_ex("Failed writing to file " + os::filename_to_str(_filename) + ": " + std::strerror(errno));
+            }
+            _stats.bytes_written += written;
+            data += written;
+            size -= written;
+        }
+    }
+
+    // write the buffer from offset done, it is empty afterwards.
+    // on failure only what was not written is left in it, so a later flush does not write anything twice
+    void write_buffer(size_t done)
+    {
+        const char* data = _buffer + done;
+        size_t size = _used - done;
+        try
+        {
+            write_fully(data, size);
+        }
+        catch (...)
+        {
+            std::memmove(_buffer, data, size);
+            _used = size;
+            throw;
+        }
+        _used = 0;
+    }
+
+    // write the buffered messages followed by data, the buffer is empty afterwards
+    void writev_fully(const char* data, size_t size)
+    {
+        if (!_used)
+            return write_fully(data, size);
+
+        iovec iov[2];
+        iov[0].iov_base = _buffer;
+        iov[0].iov_len = _used;
+        iov[1].iov_base = const_cast<char*>(data);
+        iov[1].iov_len = size;
+        ssize_t written;
+        do
+        {
+            written = ::writev(_fd, iov, 2);
+            ++_stats.write_calls;
+        }
+        while (written < 0 && errno == EINTR);
+        if (written < 0)
+            throw spdlog_ex("Failed writing to file " + os::filename_to_str(_filename) + ": " + std::strerror(errno));
+
+        // short write: finish with plain writes
+        size_t done = static_cast<size_t>(written);
+        _stats.bytes_written += done;
+        if (done < iov[0].iov_len)
+        {
+            write_buffer(done);
+            done = iov[0].iov_len;
+        }
+        _used = 0;
+        data += done - iov[0].iov_len;
+        size -= done - iov[0].iov_len;
+        write_fully(data, size);
+    }
+
+    int _fd;
+    filename_t _filename;
+    durability_policy _durability;
+    char* _buffer;
+    size_t _capacity;
+    size_t _used;
+    size_t _file_size;
+    size_t _unsynced;
+    std::chrono::steady_clock::time_point _last_sync;
+    fd_file_stats _stats;
+};
+}
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include <spdlog/details/log_msg.h>
 
 #include <string>
+#include <type_traits>
 
 // Line logger class - aggregates operator<< calls to fast ostream
 // and logs upon destruction
@@ -69,9 +70,16 @@ public:
     bool is_enabled() const;
 
 private:
+    // keep the arguments for the async worker to format, false if they cannot be kept
+    template <typename... Args>
+    bool defer(std::true_type, const char* fmt, const Args&... args);
+    template <typename... Args>
+    bool defer(std::false_type, const char* fmt, const Args&... args);
+
     logger* _callback_logger;
     log_msg _log_msg;
     bool _enabled;
+    fmt::internal::Value _fmt_values[fmt::ArgList::MAX_PACKED_ARGS];
 };
 } //Namespace details
 } // Namespace spdlog
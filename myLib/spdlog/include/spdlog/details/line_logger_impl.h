@@ -6,9 +6,12 @@
 #include <type_traits>
 
 #include <spdlog/details/line_logger_fwd.h>
+#include <spdlog/details/deferred_format.h>
 #include <spdlog/common.h>
 #include <spdlog/logger.h>
 
+#include <algorithm>
+#include <iterator>
 #include <string>
 #include <utility>
 
@@ -26,6 +29,11 @@ inline spdlog::details::line_logger::line_logger(line_logger&& other) :
     _log_msg(std::move(other._log_msg)),
     _enabled(other._enabled)
 {
+    if (_log_msg.fmt_str)
+    {
+        std::copy(std::begin(other._fmt_values), std::end(other._fmt_values), _fmt_values);
+        _log_msg.fmt_values = _fmt_values;
+    }
     other.disable();
 }
 
@@ -64,6 +72,9 @@ inline void spdlog::details::line_logger::write(const char* fmt, const Args&...
 {
     if (!_enabled)
         return;
+    if (_callback_logger->_deferred_formatting.load(std::memory_order_relaxed) &&
+            defer(std::integral_constant<bool, (sizeof...(Args) < fmt::ArgList::MAX_PACKED_ARGS)>(), fmt, args...))
+        return;
     try
     {
         _log_msg.raw.write(fmt, args...);
@@ -74,6 +85,26 @@ inline void spdlog::details::line_logger::write(const char* fmt, const Args&...
     }
 }
 
+template <typename... Args>
+inline bool spdlog::details::line_logger::defer(std::true_type, const char* fmt, const Args&... args)
+{
+    typedef fmt::internal::ArgArray<sizeof...(Args)> ArgArray;
+    typename ArgArray::Type values = { ArgArray::template make<fmt::BasicFormatter<char> >(args)... };
+    auto types = fmt::internal::make_type(args...);
+    if (!prepare_deferred_args(types, values, sizeof...(Args)))
+        return false;
+    std::copy(values, values + sizeof...(Args), _fmt_values);
+    _log_msg.fmt_str = fmt;
+    _log_msg.fmt_types = types;
+    _log_msg.fmt_values = _fmt_values;
+    return true;
+}
+
+template <typename... Args>
+inline bool spdlog::details::line_logger::defer(std::false_type, const char*, const Args&...)
+{
+    return false;
+}
 
 //
 // Support for operator<<
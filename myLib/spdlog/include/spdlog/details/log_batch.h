@@ -0,0 +1,80 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+#include <spdlog/details/log_msg.h>
+#include <spdlog/details/format.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace spdlog
+{
+namespace details
+{
+// Messages drained at once by the async worker and handed to the sinks together.
+// Besides the messages themselves, the formatted text of all of them is kept back to back,
+// so sinks writing to a stream can write the whole batch at once.
+// Messages and buffers are reused from batch to batch.
+class log_batch
+{
+public:
+    log_batch() :_count(0) {}
+
+    log_batch(const log_batch&) = delete;
+    log_batch& operator=(const log_batch&) = delete;
+
+    const log_msg* begin() const
+    {
+        return _msgs.data();
+    }
+    const log_msg* end() const
+    {
+        return _msgs.data() + _count;
+    }
+    size_t size() const
+    {
+        return _count;
+    }
+    bool empty() const
+    {
+        return _count == 0;
+    }
+
+    // formatted text of all the messages, in order
+    const fmt::MemoryWriter& formatted() const
+    {
+        return _formatted;
+    }
+
+    // message to fill for the next entry of the batch
+    log_msg& next()
+    {
+        if (_count == _msgs.size())
+            _msgs.emplace_back();
+        return _msgs[_count];
+    }
+
+    // add the message returned by next(), once formatted, to the batch
+    void commit()
+    {
+        const log_msg& msg = _msgs[_count++];
+        _formatted << fmt::StringRef(msg.formatted.data(), msg.formatted.size());
+    }
+
+    void clear()
+    {
+        _count = 0;
+        _formatted.clear();
+    }
+
+private:
+    std::vector<log_msg> _msgs;
+    size_t _count;
+    fmt::MemoryWriter _formatted;
+};
+}
+}
@@ -8,6 +8,8 @@
 #include <spdlog/common.h>
 #include <spdlog/details/format.h>
 
+#include <cstdint>
+#include <ostream>
 #include <string>
 #include <utility>
 
@@ -15,6 +17,84 @@ namespace spdlog
 {
 namespace details
 {
+// Name of the logger of a message: reads as a const std::string&, referring to the name owned by
+// the logger, which outlives the message, so messages carry it without copying it.
+// A message without logger reads as an empty name.
+class logger_name_ref
+{
+public:
+    logger_name_ref() : _name(&no_name()) {}
+    logger_name_ref(const std::string* name) : _name(name ? name : &no_name()) {}
+    logger_name_ref(const std::string& name) : _name(&name) {}
+    logger_name_ref(std::string&&) = delete; // would dangle
+
+    operator const std::string&() const
+    {
+        return *_name;
+    }
+    operator fmt::StringRef() const
+    {
+        return fmt::StringRef(_name->data(), _name->size());
+    }
+    const std::string& str() const
+    {
+        return *_name;
+    }
+    const char* c_str() const
+    {
+        return _name->c_str();
+    }
+    const char* data() const
+    {
+        return _name->data();
+    }
+    size_t size() const
+    {
+        return _name->size();
+    }
+    bool empty() const
+    {
+        return _name->empty();
+    }
+
+private:
+    static const std::string& no_name()
+    {
+        static const std::string empty;
+        return empty;
+    }
+    const std::string* _name;
+};
+
+inline bool operator==(const logger_name_ref& left, const std::string& right)
+{
+    return left.str() == right;
+}
+inline bool operator==(const std::string& left, const logger_name_ref& right)
+{
+    return left == right.str();
+}
+inline bool operator==(const logger_name_ref& left, const char* right)
+{
+    return left.str() == right;
+}
+inline bool operator!=(const logger_name_ref& left, const std::string& right)
+{
+    return !(left == right);
+}
+inline bool operator!=(const std::string& left, const logger_name_ref& right)
+{
+    return !(left == right);
+}
+inline bool operator!=(const logger_name_ref& left, const char* right)
+{
+    return !(left == right);
+}
+inline std::ostream& operator<<(std::ostream& os, const logger_name_ref& name)
+{
+    return os << name.str();
+}
+
 struct log_msg
 {
     log_msg() = default;
@@ -29,7 +109,10 @@ struct log_msg
         logger_name(other.logger_name),
         level(other.level),
         time(other.time),
-        thread_id(other.thread_id)
+        thread_id(other.thread_id),
+        fmt_str(other.fmt_str),
+        fmt_types(other.fmt_types),
+        fmt_values(other.fmt_values)
     {
         if (other.raw.size())
             raw << fmt::BasicStringRef<char>(other.raw.data(), other.raw.size());
@@ -38,12 +121,15 @@ struct log_msg
     }
 
     log_msg(log_msg&& other) :
-        logger_name(std::move(other.logger_name)),
+        logger_name(other.logger_name),
         level(other.level),
         time(std::move(other.time)),
         thread_id(other.thread_id),
         raw(std::move(other.raw)),
-        formatted(std::move(other.formatted))
+        formatted(std::move(other.formatted)),
+        fmt_str(other.fmt_str),
+        fmt_types(other.fmt_types),
+        fmt_values(other.fmt_values)
     {
         other.clear();
     }
@@ -53,12 +139,15 @@ struct log_msg
         if (this == &other)
             return *this;
 
-        logger_name = std::move(other.logger_name);
+        logger_name = other.logger_name;
         level = other.level;
         time = std::move(other.time);
         thread_id = other.thread_id;
         raw = std::move(other.raw);
         formatted = std::move(other.formatted);
+        fmt_str = other.fmt_str;
+        fmt_types = other.fmt_types;
+        fmt_values = other.fmt_values;
         other.clear();
         return *this;
     }
@@ -68,14 +157,22 @@ struct log_msg
         level = level::off;
         raw.clear();
         formatted.clear();
+        fmt_str = nullptr;
     }
 
-    std::string logger_name;
+    logger_name_ref logger_name;
     level::level_enum level;
     log_clock::time_point time;
     size_t thread_id;
     fmt::MemoryWriter raw;
     fmt::MemoryWriter formatted;
+
+    // deferred formatting (see deferred_format.h): when fmt_str is set, the text of the message
+    // is fmt_str formatted with the arguments, followed by raw.
+    // the argument values belong to the line_logger
+    const char* fmt_str = nullptr;
+    uint64_t fmt_types = 0;
+    const fmt::internal::Value* fmt_values = nullptr;
 };
 }
 }
@@ -22,6 +22,7 @@ inline spdlog::logger::logger(const std::string& logger_name, const It& begin, c
     // no support under vs2013 for member initialization for std::atomic
     _level = level::info;
     _flush_level = level::off;
+    _deferred_formatting = false;
 }
 
 // ctor with sinks as init list
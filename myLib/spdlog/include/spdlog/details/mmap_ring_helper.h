@@ -0,0 +1,291 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Helper class for mmap_ring_sink (posix only)
+// The file is a small header followed by a fixed size data area, used as a circular buffer:
+// each message is copied in the mapping at the write cursor as a record (its length, then its text),
+// wrapping around at the end, and the oldest records are overwritten. The kernel owns the dirty pages,
+// so what was written survives a crash of the process. read() rebuilds the messages in chronological order.
+// When failing to open a file, retry several times(5) with small delay between the tries(10 ms)
+// Throw spdlog_ex exception on errors
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <spdlog/common.h>
+#include <spdlog/details/os.h>
+#include <spdlog/details/log_msg.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace spdlog
+{
+namespace details
+{
+
+// at the start of the file, the data area follows at mmap_ring_header::size
+struct mmap_ring_header
+{
+    static const size_t size = 64;
+    static const uint32_t current_version = 2;
+    // each record starts with the length of the message, as a uint32_t
+    static const size_t record_prefix = sizeof(uint32_t);
+
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t capacity; // size of the data area
+    uint64_t written; // bytes written since the file was created, the cursor is at written % capacity
+    uint64_t oldest; // start of the oldest record still whole in the ring, records follow up to written
+
+    static const char* expected_magic()
+    {
+        return "spdring";
+    }
+    bool valid() const
+    {
+        return std::memcmp(magic, expected_magic(), sizeof(magic)) == 0 && version == current_version &&
+               header_size == size && capacity > record_prefix && oldest <= written && written - oldest <= capacity;
+    }
+};
+
+class mmap_ring_helper
+{
+
+public:
+    const int open_tries = 5;
+    const int open_interval = 10;
+
+    mmap_ring_helper() :
+        _fd(-1),
+        _mapping(nullptr),
+        _header(nullptr),
+        _data(nullptr),
+        _capacity(0)
+    {}
+
+    mmap_ring_helper(const mmap_ring_helper&) = delete;
+    mmap_ring_helper& operator=(const mmap_ring_helper&) = delete;
+
+    ~mmap_ring_helper()
+    {
+        close();
+    }
+
+    // map the file, creating it with a data area of capacity bytes if needed.
+    // an existing ring of the same capacity is continued, unless truncate is set.
+    void open(const filename_t& fname, size_t capacity, bool truncate = false)
+    {
+        close();
+        if (capacity <= mmap_ring_header::record_prefix)
+            throw spdlog_ex("mmap_ring_helper: capacity of " + os::filename_to_str(fname) + " is too small");
+        _filename = fname;
+        for (int tries = 0; tries < open_tries && _fd == -1; ++tries)
+        {
+            _fd = ::open(fname.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (_fd == -1)
+                std::this_thread::sleep_for(std::chrono::milliseconds(open_interval));
+        }
+        if (_fd == -1)
+            throw spdlog_ex("Failed opening file " + os::filename_to_str(_filename) + " for writing");
+
+        size_t file_size = mmap_ring_header::size + capacity;
+        struct stat st;
+        bool resume = false;
+        if (!truncate && ::fstat(_fd, &st) == 0 && static_cast<size_t>(st.st_size) == file_size)
+        {
+            mmap_ring_header existing;
+            resume = ::pread(_fd, &existing, sizeof(existing), 0) == static_cast<ssize_t>(sizeof(existing)) &&
+                     existing.valid() && existing.capacity == capacity;
+        }
+        if (!resume && (::ftruncate(_fd, 0) != 0 || ::ftruncate(_fd, static_cast<off_t>(file_size)) != 0))
+            fail("Failed resizing file ");
+
+        void* mapping = ::mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+        if (mapping == MAP_FAILED)
+            fail("Failed mapping file ");
+        _mapping = static_cast<char*>(mapping);
+        _header = reinterpret_cast<mmap_ring_header*>(_mapping);
+        _data = _mapping + mmap_ring_header::size;
+        _capacity = capacity;
+        if (!resume)
+        {
+            std::memcpy(_header->magic, mmap_ring_header::expected_magic(), sizeof(_header->magic));
+            _header->version = mmap_ring_header::current_version;
+            _header->header_size = mmap_ring_header::size;
+            _header->capacity = capacity;
+            _header->written = 0;
+            _header->oldest = 0;
+        }
+    }
+
+    void close()
+    {
+        if (_mapping)
+        {
+            ::munmap(_mapping, mmap_ring_header::size + _capacity);
+            _mapping = nullptr;
+            _header = nullptr;
+            _data = nullptr;
+        }
+        if (_fd != -1)
+        {
+            ::close(_fd);
+            _fd = -1;
+        }
+    }
+
+    void write(const log_msg& msg)
+    {
+        write(msg.formatted.data(), msg.formatted.size());
+    }
+
+    // copy a record at the cursor, wrapping around. only the end of a message longer than the ring is kept
+    void write(const char* data, size_t size)
+    {
+        if (!_mapping)
+            throw spdlog_ex("Failed writing to closed file " + os::filename_to_str(_filename));
+        size_t max_size = std::min<size_t>(_capacity - mmap_ring_header::record_prefix, UINT32_MAX);
+        if (size > max_size)
+        {
+            data += size - max_size;
+            size = max_size;
+        }
+        uint64_t start = _header->written;
+        uint64_t end = start + mmap_ring_header::record_prefix + size;
+        // forget the records about to be overwritten first, so a copy cut by a crash is out of oldest..written
+        uint64_t oldest = _header->oldest;
+        while (end - oldest > _capacity)
+        {
+            uint32_t length;
+            copy_out(_data, _capacity, oldest, &length, sizeof(length));
+            oldest = std::min(oldest + mmap_ring_header::record_prefix + length, start);
+        }
+        _header->oldest = oldest;
+        std::atomic_signal_fence(std::memory_order_release);
+
+        uint32_t length = static_cast<uint32_t>(size);
+        copy_in(start, &length, sizeof(length));
+        copy_in(start + mmap_ring_header::record_prefix, data, size);
+        // the cursor moves once the record is complete, a record cut by a crash is not read back
+        std::atomic_signal_fence(std::memory_order_release);
+        _header->written = end;
+    }
+
+    // wait for the mapping to be written to disk. not needed to survive a crash of the process
+    void sync()
+    {
+        if (_mapping && ::msync(_mapping, mmap_ring_header::size + _capacity, MS_SYNC) != 0)
+            fail("Failed syncing file ");
+    }
+
+    uint64_t written() const
+    {
+        return _header ? _header->written : 0;
+    }
+
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+
+    const filename_t& filename() const
+    {
+        return _filename;
+    }
+
+    // messages of a ring file in chronological order, from the oldest record still whole
+    static std::string read(const filename_t& fname)
+    {
+        FILE* file;
+        if (os::fopen_s(&file, fname, SPDLOG_FILENAME_T("rb")))
+            throw spdlog_ex("Failed opening file " + os::filename_to_str(fname) + " for reading");
+
+        mmap_ring_header header;
+        std::string data;
+        bool valid = std::fread(&header, sizeof(header), 1, file) == 1 && header.valid() &&
+                     std::fseek(file, 0, SEEK_END) == 0 &&
+                     static_cast<uint64_t>(std::ftell(file)) == mmap_ring_header::size + header.capacity &&
+                     std::fseek(file, mmap_ring_header::size, SEEK_SET) == 0;
+        if (valid)
+        {
+            data.resize(static_cast<size_t>(header.capacity));
+            valid = std::fread(&data[0], 1, data.size(), file) == data.size();
+        }
+        std::fclose(file);
+
+        std::string messages;
+        for (uint64_t pos = header.oldest; valid && pos < header.written;)
+        {
+            uint32_t length = 0;
+            valid = header.written - pos >= mmap_ring_header::record_prefix;
+            if (valid)
+            {
+                copy_out(data.data(), data.size(), pos, &length, sizeof(length));
+                pos += mmap_ring_header::record_prefix;
+                valid = length <= header.written - pos;
+            }
+            if (valid)
+            {
+                size_t offset = messages.size();
+                messages.resize(offset + length);
+                copy_out(data.data(), data.size(), pos, &messages[offset], length);
+                pos += length;
+            }
+        }
+        if (!valid)
+            throw spdlog_ex("Not a valid ring file " + os::filename_to_str(fname));
+        return messages;
+    }
+
+private:
+    void copy_in(uint64_t at, const void* from, size_t size)
+    {
+        size_t pos = static_cast<size_t>(at % _capacity);
+        size_t first = std::min(size, _capacity - pos);
+        std::memcpy(_data + pos, from, first);
+        std::memcpy(_data, static_cast<const char*>(from) + first, size - first);
+    }
+
+    static void copy_out(const char* ring, size_t capacity, uint64_t at, void* to, size_t size)
+    {
+        size_t pos = static_cast<size_t>(at % capacity);
+        size_t first = std::min(size, capacity - pos);
+        std::memcpy(to, ring + pos, first);
+        std::memcpy(static_cast<char*>(to) + first, ring, size - first);
+    }
+
+    void fail(const char* what)
+    {
+        int error = errno;
+        close();
+        throw spdlog_ex(what + os::filename_to_str(_filename) + ": " + std::strerror(error));
+    }
+
+    int _fd;
+    filename_t _filename;
+    char* _mapping;
+    mmap_ring_header* _header;
+    char* _data;
+    size_t _capacity;
+};
+}
+}
+
+#endif
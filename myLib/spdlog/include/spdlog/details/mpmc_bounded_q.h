@@ -44,6 +44,7 @@ Distributed under the MIT License (http://opensource.org/licenses/MIT)
 #pragma once
 
 #include <spdlog/common.h>
+#include <spdlog/details/cacheline_buffer.h>
 
 #include <atomic>
 #include <utility>
@@ -60,7 +61,7 @@ public:
 
     using item_type = T;
     mpmc_bounded_queue(size_t buffer_size)
-        : buffer_(new cell_t [buffer_size]),
+        : buffer_(buffer_size),
           buffer_mask_(buffer_size - 1)
     {
         //queue size must be power of two
@@ -73,11 +74,6 @@ public:
         dequeue_pos_.store(0, std::memory_order_relaxed);
     }
 
-    ~mpmc_bounded_queue()
-    {
-        delete [] buffer_;
-    }
-
 
     bool enqueue(T&& data)
     {
@@ -132,6 +128,13 @@ public:
         return true;
     }
 
+    // true if there was nothing to dequeue when called.
+    // a concurrent enqueue may make it report a message that cannot be dequeued just yet
+    bool is_empty() const
+    {
+        return enqueue_pos_.load(std::memory_order_relaxed) == dequeue_pos_.load(std::memory_order_relaxed);
+    }
+
 private:
     struct cell_t
     {
@@ -139,11 +142,10 @@ private:
         T                     data_;
     };
 
-    static size_t const     cacheline_size = 64;
     typedef char            cacheline_pad_t [cacheline_size];
 
     cacheline_pad_t         pad0_;
-    cell_t* const           buffer_;
+    cacheline_buffer<cell_t> buffer_;
     size_t const            buffer_mask_;
     cacheline_pad_t         pad1_;
     std::atomic<size_t>     enqueue_pos_;
@@ -10,7 +10,9 @@
 #include <spdlog/details/os.h>
 #include <spdlog/details/format.h>
 
+#include <atomic>
 #include <chrono>
+#include <cstring>
 #include <ctime>
 #include <memory>
 #include <mutex>
@@ -28,25 +30,119 @@ class flag_formatter
 public:
     virtual ~flag_formatter() {}
     virtual void format(details::log_msg& msg, const std::tm& tm_time) = 0;
+    // true if the text only changes with the second of the message time, so it can be cached
+    virtual bool per_second() const
+    {
+        return false;
+    }
+};
+
+// date and time appenders with a resolution of one second
+class second_flag_formatter :public flag_formatter
+{
+public:
+    bool per_second() const override
+    {
+        return true;
+    }
+};
+
+// broken-down local time of the message, localtime() only runs once a second for each thread
+inline const std::tm& cached_localtime(const log_clock::time_point& time)
+{
+    struct cache
+    {
+        bool valid = false;
+        std::time_t time = 0;
+        std::tm tm_time;
+    };
+    static thread_local cache t_cache;
+    auto t = log_clock::to_time_t(time);
+    if (!t_cache.valid || t_cache.time != t)
+    {
+        t_cache.tm_time = os::localtime(t);
+        t_cache.time = t;
+        t_cache.valid = true;
+    }
+    return t_cache.tm_time;
+}
+
+// Text which only changes once a second, such as the date and time prefix of the lines.
+// Formatters are shared by threads, so each thread keeps the text of its last second:
+// a few entries per thread, shared by all the caches
+class second_cache
+{
+public:
+    second_cache() :_id(next_id()) {}
+    second_cache(const second_cache&) = delete;
+    second_cache& operator=(const second_cache&) = delete;
+
+    // append the text for the second of msg, rendered by render(msg) when not cached
+    template<class Render>
+    void append(details::log_msg& msg, const Render& render)
+    {
+        auto& e = entries()[_id % entry_count];
+        auto t = log_clock::to_time_t(msg.time);
+        if (e.id == _id && e.time == t)
+        {
+            msg.formatted << fmt::StringRef(e.text, e.size);
+            return;
+        }
+        auto start = msg.formatted.size();
+        render(msg);
+        auto size = msg.formatted.size() - start;
+        if (size > sizeof(e.text))
+        {
+            e.id = 0;
+            return;
+        }
+        std::memcpy(e.text, msg.formatted.data() + start, size);
+        e.size = size;
+        e.time = t;
+        e.id = _id;
+    }
+
+private:
+    static const size_t entry_count = 4;
+    struct entry
+    {
+        size_t id = 0;
+        std::time_t time = 0;
+        size_t size = 0;
+        char text[64];
+    };
+
+    static entry* entries()
+    {
+        static thread_local entry t_entries[entry_count];
+        return t_entries;
+    }
+
+    static size_t next_id()
+    {
+        static std::atomic<size_t> s_id(0);
+        return ++s_id;
+    }
+
+    const size_t _id;
 };
 
 ///////////////////////////////////////////////////////////////////////
 // name & level pattern appenders
 ///////////////////////////////////////////////////////////////////////
-namespace
-{
 class name_formatter :public flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm&) override
     {
         msg.formatted << msg.logger_name;
     }
 };
-}
 
 // log level appender
 class level_formatter :public flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm&) override
     {
         msg.formatted << level::to_str(msg.level);
@@ -56,6 +152,7 @@ class level_formatter :public flag_formatter
 // short log level appender
 class short_level_formatter :public flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm&) override
     {
         msg.formatted << level::to_short_str(msg.level);
@@ -78,8 +175,9 @@ static int to12h(const tm& t)
 
 //Abbreviated weekday name
 static const std::string days[] { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
-class a_formatter :public flag_formatter
+class a_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         msg.formatted << days[tm_time.tm_wday];
@@ -88,8 +186,9 @@ class a_formatter :public flag_formatter
 
 //Full weekday name
 static const std::string full_days[] { "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday" };
-class A_formatter :public flag_formatter
+class A_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         msg.formatted << full_days[tm_time.tm_wday];
@@ -98,8 +197,9 @@ class A_formatter :public flag_formatter
 
 //Abbreviated month
 static const std::string  months[] { "Jan", "Feb", "Mar", "Apr", "May", "June", "July", "Aug", "Sept", "Oct", "Nov", "Dec" };
-class b_formatter :public flag_formatter
+class b_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         msg.formatted<< months[tm_time.tm_mon];
@@ -108,8 +208,9 @@ class b_formatter :public flag_formatter
 
 //Full month name
 static const std::string full_months[] { "January", "February", "March", "April", "May", "June", "July", "August", "September", "October", "November", "December" };
-class B_formatter :public flag_formatter
+class B_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         msg.formatted << full_months[tm_time.tm_mon];
@@ -133,8 +234,9 @@ static fmt::MemoryWriter& pad_n_join(fmt::MemoryWriter& w, int v1, int v2, int v
 
 
 //Date and time representation (Thu Aug 23 15:35:46 2014)
-class c_formatter :public flag_formatter
+class c_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         msg.formatted << days[tm_time.tm_wday] << ' ' << months[tm_time.tm_mon] << ' ' << tm_time.tm_mday << ' ';
@@ -144,8 +246,9 @@ class c_formatter :public flag_formatter
 
 
 // year - 2 digit
-class C_formatter :public flag_formatter
+class C_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         msg.formatted << fmt::pad(tm_time.tm_year % 100, 2, '0');
@@ -155,8 +258,9 @@ class C_formatter :public flag_formatter
 
 
 // Short MM/DD/YY date, equivalent to %m/%d/%y 08/23/01
-class D_formatter :public flag_formatter
+class D_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         pad_n_join(msg.formatted, tm_time.tm_mon + 1, tm_time.tm_mday, tm_time.tm_year % 100, '/');
@@ -165,8 +269,9 @@ class D_formatter :public flag_formatter
 
 
 // year - 4 digit
-class Y_formatter :public flag_formatter
+class Y_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         msg.formatted << tm_time.tm_year + 1900;
@@ -174,8 +279,9 @@ class Y_formatter :public flag_formatter
 };
 
 // month 1-12
-class m_formatter :public flag_formatter
+class m_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         msg.formatted << fmt::pad(tm_time.tm_mon + 1, 2, '0');
@@ -183,8 +289,9 @@ class m_formatter :public flag_formatter
 };
 
 // day of month 1-31
-class d_formatter :public flag_formatter
+class d_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         msg.formatted << fmt::pad(tm_time.tm_mday, 2, '0');
@@ -192,8 +299,9 @@ class d_formatter :public flag_formatter
 };
 
 // hours in 24 format  0-23
-class H_formatter :public flag_formatter
+class H_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         msg.formatted << fmt::pad(tm_time.tm_hour, 2, '0');
@@ -201,8 +309,9 @@ class H_formatter :public flag_formatter
 };
 
 // hours in 12 format  1-12
-class I_formatter :public flag_formatter
+class I_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         msg.formatted << fmt::pad(to12h(tm_time), 2, '0');
@@ -210,8 +319,9 @@ class I_formatter :public flag_formatter
 };
 
 // minutes 0-59
-class M_formatter :public flag_formatter
+class M_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         msg.formatted << fmt::pad(tm_time.tm_min, 2, '0');
@@ -219,8 +329,9 @@ class M_formatter :public flag_formatter
 };
 
 // seconds 0-59
-class S_formatter :public flag_formatter
+class S_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         msg.formatted << fmt::pad(tm_time.tm_sec, 2, '0');
@@ -230,6 +341,7 @@ class S_formatter :public flag_formatter
 // milliseconds
 class e_formatter :public flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm&) override
     {
         auto duration = msg.time.time_since_epoch();
@@ -241,6 +353,7 @@ class e_formatter :public flag_formatter
 // microseconds
 class f_formatter :public flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm&) override
     {
         auto duration = msg.time.time_since_epoch();
@@ -252,6 +365,7 @@ class f_formatter :public flag_formatter
 // nanoseconds
 class F_formatter :public flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm&) override
     {
         auto duration = msg.time.time_since_epoch();
@@ -261,8 +375,9 @@ class F_formatter :public flag_formatter
 };
 
 // AM/PM
-class p_formatter :public flag_formatter
+class p_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         msg.formatted << ampm(tm_time);
@@ -271,8 +386,9 @@ class p_formatter :public flag_formatter
 
 
 // 12 hour clock 02:55:02 pm
-class r_formatter :public flag_formatter
+class r_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         pad_n_join(msg.formatted, to12h(tm_time), tm_time.tm_min, tm_time.tm_sec, ':') << ' ' << ampm(tm_time);
@@ -280,8 +396,9 @@ class r_formatter :public flag_formatter
 };
 
 // 24-hour HH:MM time, equivalent to %H:%M
-class R_formatter :public flag_formatter
+class R_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         pad_n_join(msg.formatted, tm_time.tm_hour, tm_time.tm_min, ':');
@@ -289,8 +406,9 @@ class R_formatter :public flag_formatter
 };
 
 // ISO 8601 time format (HH:MM:SS), equivalent to %H:%M:%S
-class T_formatter :public flag_formatter
+class T_formatter :public second_flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
         pad_n_join(msg.formatted, tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec, ':');
@@ -349,6 +467,7 @@ private:
 //Thread id
 class t_formatter :public flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm&) override
     {
         msg.formatted << msg.thread_id;
@@ -358,6 +477,7 @@ class t_formatter :public flag_formatter
 
 class v_formatter :public flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm&) override
     {
         msg.formatted << fmt::StringRef(msg.raw.data(), msg.raw.size());
@@ -373,6 +493,10 @@ public:
     {
         msg.formatted << _ch;
     }
+    bool per_second() const override
+    {
+        return true;
+    }
 private:
     char _ch;
 };
@@ -392,14 +516,40 @@ public:
     {
         msg.formatted << _str;
     }
+    bool per_second() const override
+    {
+        return true;
+    }
 private:
     std::string _str;
 };
 
+// a run of date and time flags and user chars, rendered once a second
+class second_run_formatter :public flag_formatter
+{
+public:
+    void add(std::unique_ptr<flag_formatter> f)
+    {
+        _formatters.push_back(std::move(f));
+    }
+    void format(details::log_msg& msg, const std::tm& tm_time) override
+    {
+        _cache.append(msg, [this, &tm_time](details::log_msg& m)
+        {
+            for (auto& f : _formatters)
+                f->format(m, tm_time);
+        });
+    }
+private:
+    std::vector<std::unique_ptr<flag_formatter>> _formatters;
+    second_cache _cache;
+};
+
 // Full info formatter
 // pattern: [%Y-%m-%d %H:%M:%S.%e] [%n] [%l] %v
 class full_formatter :public flag_formatter
 {
+public:
     void format(details::log_msg& msg, const std::tm& tm_time) override
     {
 #ifndef SPDLOG_NO_DATETIME
@@ -420,14 +570,18 @@ class full_formatter :public flag_formatter
         msg.raw.str());*/
 
 
-        // Faster (albeit uglier) way to format the line (5.6 million lines/sec under 10 threads)
-        msg.formatted << '[' << static_cast<unsigned int>(tm_time.tm_year + 1900) << '-'
-                      << fmt::pad(static_cast<unsigned int>(tm_time.tm_mon + 1), 2, '0') << '-'
-                      << fmt::pad(static_cast<unsigned int>(tm_time.tm_mday), 2, '0') << ' '
-                      << fmt::pad(static_cast<unsigned int>(tm_time.tm_hour), 2, '0') << ':'
-                      << fmt::pad(static_cast<unsigned int>(tm_time.tm_min), 2, '0') << ':'
-                      << fmt::pad(static_cast<unsigned int>(tm_time.tm_sec), 2, '0') << '.'
-                      << fmt::pad(static_cast<unsigned int>(millis), 3, '0') << "] ";
+        // Faster (albeit uglier) way to format the line (5.6 million lines/sec under 10 threads),
+        // and only the milliseconds change within a second
+        _date_cache.append(msg, [&tm_time](details::log_msg& m)
+        {
+            m.formatted << '[' << static_cast<unsigned int>(tm_time.tm_year + 1900) << '-'
+                        << fmt::pad(static_cast<unsigned int>(tm_time.tm_mon + 1), 2, '0') << '-'
+                        << fmt::pad(static_cast<unsigned int>(tm_time.tm_mday), 2, '0') << ' '
+                        << fmt::pad(static_cast<unsigned int>(tm_time.tm_hour), 2, '0') << ':'
+                        << fmt::pad(static_cast<unsigned int>(tm_time.tm_min), 2, '0') << ':'
+                        << fmt::pad(static_cast<unsigned int>(tm_time.tm_sec), 2, '0') << '.';
+        });
+        msg.formatted << fmt::pad(static_cast<unsigned int>(millis), 3, '0') << "] ";
 
 //no datetime needed
 #else
@@ -441,6 +595,8 @@ class full_formatter :public flag_formatter
         msg.formatted << '[' << level::to_str(msg.level) << "] ";
         msg.formatted << fmt::StringRef(msg.raw.data(), msg.raw.size());
     }
+private:
+    second_cache _date_cache;
 };
 
 }
@@ -480,7 +636,30 @@ inline void spdlog::pattern_formatter::compile_pattern(const std::string& patter
     {
         _formatters.push_back(std::move(user_chars));
     }
+    cache_per_second_runs();
+}
 
+// replace the runs of formatters which only change once a second by one caching their text
+inline void spdlog::pattern_formatter::cache_per_second_runs()
+{
+    std::vector<std::unique_ptr<details::flag_formatter>> formatters;
+    auto end = _formatters.end();
+    for (auto it = _formatters.begin(); it != end;)
+    {
+        auto run_end = it;
+        while (run_end != end && (*run_end)->per_second())
+            ++run_end;
+        if (run_end - it < 2)
+        {
+            formatters.push_back(std::move(*it++));
+            continue;
+        }
+        std::unique_ptr<details::second_run_formatter> run(new details::second_run_formatter());
+        for (; it != run_end; ++it)
+            run->add(std::move(*it));
+        formatters.push_back(std::move(run));
+    }
+    _formatters = std::move(formatters);
 }
 inline void spdlog::pattern_formatter::handle_flag(char flag)
 {
@@ -613,7 +792,7 @@ inline void spdlog::pattern_formatter::format(details::log_msg& msg)
 {
     try
     {
-        auto tm_time = details::os::localtime(log_clock::to_time_t(msg.time));
+        auto& tm_time = details::cached_localtime(msg.time);
         for (auto &f : _formatters)
         {
             f->format(msg, tm_time);
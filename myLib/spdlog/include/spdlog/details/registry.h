@@ -15,6 +15,7 @@
 #include <spdlog/async_logger.h>
 #include <spdlog/common.h>
 
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <memory>
@@ -36,14 +37,15 @@ public:
         auto logger_name = logger->name();
         throw_if_exists(logger_name);
         _loggers[logger_name] = logger;
+        publish();
     }
 
-
+    // lock free and allocation free unless the loggers changed since the last call of the thread
     std::shared_ptr<logger> get(const std::string& logger_name)
     {
-        std::lock_guard<Mutex> lock(_mutex);
-        auto found = _loggers.find(logger_name);
-        return found == _loggers.end() ? nullptr : found->second;
+        auto& loggers = snapshot();
+        auto found = loggers.find(logger_name);
+        return found == loggers.end() ? nullptr : found->second.lock();
     }
 
     template<class It>
@@ -53,7 +55,7 @@ public:
         throw_if_exists(logger_name);
         std::shared_ptr<logger> new_logger;
         if (_async_mode)
-            new_logger = std::make_shared<async_logger>(logger_name, sinks_begin, sinks_end, _async_q_size, _overflow_policy, _worker_warmup_cb, _flush_interval_ms, _worker_teardown_cb);
+            new_logger = std::make_shared<async_logger>(logger_name, sinks_begin, sinks_end, _async_q_size, _overflow_policy, _worker_warmup_cb, _flush_interval_ms, _worker_teardown_cb, _async_q_type, _async_workers);
         else
             new_logger = std::make_shared<logger>(logger_name, sinks_begin, sinks_end);
 
@@ -63,6 +65,7 @@ public:
         new_logger->set_level(_level);
         //Add to registry
         _loggers[logger_name] = new_logger;
+        publish();
         return new_logger;
     }
 
@@ -70,13 +73,39 @@ public:
     {
         std::lock_guard<Mutex> lock(_mutex);
         _loggers.erase(logger_name);
+        publish();
     }
 
     void drop_all()
     {
         std::lock_guard<Mutex> lock(_mutex);
         _loggers.clear();
+        publish();
     }
+
+    shutdown_report shutdown(const std::chrono::steady_clock::time_point& deadline)
+    {
+        std::lock_guard<Mutex> lock(_mutex);
+        shutdown_report report;
+        for (auto& l : _loggers)
+        {
+            auto async = std::dynamic_pointer_cast<async_logger>(l.second);
+            if (async)
+            {
+                auto logger_report = async->shutdown(deadline);
+                report.lost += logger_report.lost;
+                report.workers_abandoned += logger_report.workers_abandoned;
+            }
+            else
+            {
+                l.second->flush();
+            }
+        }
+        _loggers.clear();
+        publish();
+        return report;
+    }
+
     std::shared_ptr<logger> create(const std::string& logger_name, sinks_init_list sinks)
     {
         return create(logger_name, sinks.begin(), sinks.end());
@@ -112,7 +141,7 @@ public:
         _level = log_level;
     }
 
-    void set_async_mode(size_t q_size, const async_overflow_policy overflow_policy, const std::function<void()>& worker_warmup_cb, const std::chrono::milliseconds& flush_interval_ms, const std::function<void()>& worker_teardown_cb)
+    void set_async_mode(size_t q_size, const async_overflow_policy overflow_policy, const std::function<void()>& worker_warmup_cb, const std::chrono::milliseconds& flush_interval_ms, const std::function<void()>& worker_teardown_cb, const async_queue_type queue_type, const async_workers workers)
     {
         std::lock_guard<Mutex> lock(_mutex);
         _async_mode = true;
@@ -121,6 +150,8 @@ public:
         _worker_warmup_cb = worker_warmup_cb;
         _flush_interval_ms = flush_interval_ms;
         _worker_teardown_cb = worker_teardown_cb;
+        _async_q_type = queue_type;
+        _async_workers = workers;
     }
 
     void set_sync_mode()
@@ -136,7 +167,10 @@ public:
     }
 
 private:
-    registry_t<Mutex>() {}
+    // weak references: a copy kept by a thread must not keep dropped loggers alive
+    using logger_snapshot = std::unordered_map<std::string, std::weak_ptr<logger>>;
+
+    registry_t<Mutex>() :_snapshot(std::make_shared<logger_snapshot>()), _generation(0) {}
     registry_t<Mutex>(const registry_t<Mutex>&) = delete;
     registry_t<Mutex>& operator=(const registry_t<Mutex>&) = delete;
 
@@ -145,8 +179,41 @@ private:
         if (_loggers.find(logger_name) != _loggers.end())
             throw spdlog_ex("logger with name '" + logger_name + "' already exists");
     }
+
+    // copy the loggers for the readers after a change, with _mutex held
+    void publish()
+    {
+        auto snapshot = std::make_shared<logger_snapshot>();
+        for (auto& l : _loggers)
+            snapshot->emplace(l.first, l.second);
+        _snapshot = std::move(snapshot);
+        _generation.fetch_add(1, std::memory_order_release);
+    }
+
+    // the loggers as of the last change: each thread keeps the snapshot it saw last,
+    // and only takes _mutex to pick up the new one once the generation changed
+    const logger_snapshot& snapshot()
+    {
+        struct cache
+        {
+            unsigned long generation = 0;
+            std::shared_ptr<const logger_snapshot> loggers;
+        };
+        static thread_local cache t_cache;
+        auto generation = _generation.load(std::memory_order_acquire);
+        if (!t_cache.loggers || t_cache.generation != generation)
+        {
+            std::lock_guard<Mutex> lock(_mutex);
+            t_cache.loggers = _snapshot;
+            t_cache.generation = _generation.load(std::memory_order_relaxed);
+        }
+        return *t_cache.loggers;
+    }
     Mutex _mutex;
     std::unordered_map <std::string, std::shared_ptr<logger>> _loggers;
+    // copy of _loggers for get(), replaced on each change which bumps _generation
+    std::shared_ptr<const logger_snapshot> _snapshot;
+    std::atomic<unsigned long> _generation;
     formatter_ptr _formatter;
     level::level_enum _level = level::info;
     bool _async_mode = false;
@@ -155,6 +222,8 @@ private:
     std::function<void()> _worker_warmup_cb = nullptr;
     std::chrono::milliseconds _flush_interval_ms;
     std::function<void()> _worker_teardown_cb = nullptr;
+    async_queue_type _async_q_type = async_queue_type::mpmc;
+    async_workers _async_workers = async_workers::per_logger;
 };
 #ifdef SPDLOG_NO_REGISTRY_MUTEX
 typedef registry_t<spdlog::details::null_mutex> registry;
@@ -0,0 +1,100 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Bounded single producer/single consumer ring.
+// Each side owns its position and keeps a cached copy of the other side's one,
+// so in the common case enqueue and dequeue touch no cache line written by the other thread.
+
+#include <spdlog/common.h>
+#include <spdlog/details/cacheline_buffer.h>
+
+#include <atomic>
+#include <utility>
+
+namespace spdlog
+{
+namespace details
+{
+
+template<typename T>
+class spsc_bounded_queue
+{
+public:
+
+    using item_type = T;
+    spsc_bounded_queue(size_t buffer_size)
+        : buffer_(buffer_size),
+          buffer_mask_(buffer_size - 1),
+          head_cache_(0),
+          tail_cache_(0)
+    {
+        //queue size must be power of two
+        if(!((buffer_size >= 2) && ((buffer_size & (buffer_size - 1)) == 0)))
+            throw spdlog_ex("async logger queue size must be power of two");
+
+        tail_.store(0, std::memory_order_relaxed);
+        head_.store(0, std::memory_order_relaxed);
+    }
+
+    // producer thread only
+    bool enqueue(T&& data)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ > buffer_mask_)
+        {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ > buffer_mask_)
+                return false;
+        }
+        buffer_[tail & buffer_mask_] = std::move(data);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer thread only
+    bool dequeue(T& data)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_)
+        {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_)
+                return false;
+        }
+        data = std::move(buffer_[head & buffer_mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer thread only
+    bool is_empty() const
+    {
+        return head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    typedef char            cacheline_pad_t [cacheline_size];
+
+    cacheline_pad_t         pad0_;
+    cacheline_buffer<T> buffer_;
+    size_t const            buffer_mask_;
+    cacheline_pad_t         pad1_;
+    // written by the producer
+    std::atomic<size_t>     tail_;
+    size_t                  head_cache_;
+    cacheline_pad_t         pad2_;
+    // written by the consumer
+    std::atomic<size_t>     head_;
+    size_t                  tail_cache_;
+    cacheline_pad_t         pad3_;
+
+    spsc_bounded_queue(spsc_bounded_queue const&);
+    void operator = (spsc_bounded_queue const&);
+};
+
+} // ns details
+} // ns spdlog
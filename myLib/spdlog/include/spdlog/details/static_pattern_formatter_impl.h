@@ -0,0 +1,263 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// static_pattern_formatter implementation.
+// The pattern is split at compile time into items: user chars up to the next '%', or a flag.
+// As in pattern_formatter, the runs of items which only change once a second are cached.
+// Each item is a template instance formatting itself and then the next one, so the compiler
+// inlines the whole pattern in static_pattern_formatter::format().
+
+#include <spdlog/formatter.h>
+#include <spdlog/details/pattern_formatter_impl.h>
+
+#include <cstddef>
+#include <ctime>
+
+namespace spdlog
+{
+namespace details
+{
+namespace static_pattern
+{
+// end of the user chars starting at i
+constexpr size_t chars_end(const char* p, size_t i)
+{
+    return p[i] == '\0' || p[i] == '%' ? i : chars_end(p, i + 1);
+}
+
+// end of the item starting at i. a '%' ending the pattern is ignored
+constexpr size_t item_end(const char* p, size_t i)
+{
+    return p[i] != '%' ? chars_end(p, i) : p[i + 1] == '\0' ? i + 1 : i + 2;
+}
+
+// flags which change more than once a second
+constexpr bool is_dynamic_flag(char flag)
+{
+    return flag == 'n' || flag == 'l' || flag == 'L' || flag == 't' || flag == 'v' ||
+           flag == 'e' || flag == 'f' || flag == 'F' || flag == 'z' || flag == '+';
+}
+
+constexpr bool item_per_second(const char* p, size_t i)
+{
+    return p[i] != '%' || !is_dynamic_flag(p[i + 1]);
+}
+
+// end of the run of per second items starting at i
+constexpr size_t run_end(const char* p, size_t i)
+{
+    return p[i] != '\0' && item_per_second(p, i) ? run_end(p, item_end(p, i)) : i;
+}
+
+// runs of more than one item are cached
+constexpr bool cached_run(const char* p, size_t i)
+{
+    return item_end(p, i) < run_end(p, i);
+}
+
+constexpr size_t cached_run_count(const char* p, size_t i)
+{
+    return p[i] == '\0' ? 0 :
+           cached_run(p, i) ? 1 + cached_run_count(p, run_end(p, i)) : cached_run_count(p, item_end(p, i));
+}
+}
+
+template<class Pattern>
+struct static_pattern_state
+{
+    static const size_t run_count = static_pattern::cached_run_count(Pattern::pattern(), 0);
+
+    second_cache caches[run_count ? run_count : 1];
+    z_formatter z;
+    full_formatter full;
+};
+
+namespace static_pattern
+{
+// the appender of a flag, unknown flags appear as is
+template<char Flag>
+struct flag
+{
+    template<class State>
+    static void format(State&, log_msg& msg, const std::tm&)
+    {
+        msg.formatted << '%' << Flag;
+    }
+};
+
+// a stateless flag_formatter, called without virtual dispatch
+template<class Formatter>
+struct formatter_flag
+{
+    template<class State>
+    static void format(State&, log_msg& msg, const std::tm& tm_time)
+    {
+        Formatter f;
+        f.Formatter::format(msg, tm_time);
+    }
+};
+
+#define SPDLOG_STATIC_FLAG(ch, formatter_type) \
+    template<> struct flag<ch> : formatter_flag<formatter_type> {};
+
+SPDLOG_STATIC_FLAG('n', name_formatter)
+SPDLOG_STATIC_FLAG('l', level_formatter)
+SPDLOG_STATIC_FLAG('L', short_level_formatter)
+SPDLOG_STATIC_FLAG('t', t_formatter)
+SPDLOG_STATIC_FLAG('v', v_formatter)
+SPDLOG_STATIC_FLAG('a', a_formatter)
+SPDLOG_STATIC_FLAG('A', A_formatter)
+SPDLOG_STATIC_FLAG('b', b_formatter)
+SPDLOG_STATIC_FLAG('h', b_formatter)
+SPDLOG_STATIC_FLAG('B', B_formatter)
+SPDLOG_STATIC_FLAG('c', c_formatter)
+SPDLOG_STATIC_FLAG('C', C_formatter)
+SPDLOG_STATIC_FLAG('Y', Y_formatter)
+SPDLOG_STATIC_FLAG('D', D_formatter)
+SPDLOG_STATIC_FLAG('x', D_formatter)
+SPDLOG_STATIC_FLAG('m', m_formatter)
+SPDLOG_STATIC_FLAG('d', d_formatter)
+SPDLOG_STATIC_FLAG('H', H_formatter)
+SPDLOG_STATIC_FLAG('I', I_formatter)
+SPDLOG_STATIC_FLAG('M', M_formatter)
+SPDLOG_STATIC_FLAG('S', S_formatter)
+SPDLOG_STATIC_FLAG('e', e_formatter)
+SPDLOG_STATIC_FLAG('f', f_formatter)
+SPDLOG_STATIC_FLAG('F', F_formatter)
+SPDLOG_STATIC_FLAG('p', p_formatter)
+SPDLOG_STATIC_FLAG('r', r_formatter)
+SPDLOG_STATIC_FLAG('R', R_formatter)
+SPDLOG_STATIC_FLAG('T', T_formatter)
+SPDLOG_STATIC_FLAG('X', T_formatter)
+
+#undef SPDLOG_STATIC_FLAG
+
+// flags with a state, kept by the formatter
+template<>
+struct flag<'z'>
+{
+    template<class State>
+    static void format(State& state, log_msg& msg, const std::tm& tm_time)
+    {
+        state.z.z_formatter::format(msg, tm_time);
+    }
+};
+
+template<>
+struct flag<'+'>
+{
+    template<class State>
+    static void format(State& state, log_msg& msg, const std::tm& tm_time)
+    {
+        state.full.full_formatter::format(msg, tm_time);
+    }
+};
+
+// the '%' ending the pattern
+template<>
+struct flag<'\0'>
+{
+    template<class State>
+    static void format(State&, log_msg&, const std::tm&)
+    {}
+};
+
+// the item starting at I: a flag or user chars
+template<class Pattern, size_t I, bool IsFlag = Pattern::pattern()[I] == '%'>
+struct item
+{
+    template<class State>
+    static void format(State& state, log_msg& msg, const std::tm& tm_time)
+    {
+        flag<Pattern::pattern()[I + 1]>::format(state, msg, tm_time);
+    }
+};
+
+template<class Pattern, size_t I>
+struct item<Pattern, I, false>
+{
+    template<class State>
+    static void format(State&, log_msg& msg, const std::tm&)
+    {
+        msg.formatted << fmt::StringRef(Pattern::pattern() + I, chars_end(Pattern::pattern(), I) - I);
+    }
+};
+
+// the items from I to End
+template<class Pattern, size_t I, size_t End, bool Empty = I >= End>
+struct items
+{
+    template<class State>
+    static void format(State& state, log_msg& msg, const std::tm& tm_time)
+    {
+        item<Pattern, I>::format(state, msg, tm_time);
+        items<Pattern, item_end(Pattern::pattern(), I), End>::format(state, msg, tm_time);
+    }
+};
+
+template<class Pattern, size_t I, size_t End>
+struct items<Pattern, I, End, true>
+{
+    template<class State>
+    static void format(State&, log_msg&, const std::tm&)
+    {}
+};
+
+// the items from I to the end of the pattern, Run is the index of the next cached run
+template<class Pattern, size_t I, size_t Run,
+         bool End = Pattern::pattern()[I] == '\0',
+         bool Cached = cached_run(Pattern::pattern(), I)>
+struct runs
+{
+    template<class State>
+    static void format(State& state, log_msg& msg, const std::tm& tm_time)
+    {
+        item<Pattern, I>::format(state, msg, tm_time);
+        runs<Pattern, item_end(Pattern::pattern(), I), Run>::format(state, msg, tm_time);
+    }
+};
+
+template<class Pattern, size_t I, size_t Run>
+struct runs<Pattern, I, Run, false, true>
+{
+    template<class State>
+    static void format(State& state, log_msg& msg, const std::tm& tm_time)
+    {
+        state.caches[Run].append(msg, [&state, &tm_time](log_msg& m)
+        {
+            items<Pattern, I, run_end(Pattern::pattern(), I)>::format(state, m, tm_time);
+        });
+        runs<Pattern, run_end(Pattern::pattern(), I), Run + 1>::format(state, msg, tm_time);
+    }
+};
+
+template<class Pattern, size_t I, size_t Run>
+struct runs<Pattern, I, Run, true, false>
+{
+    template<class State>
+    static void format(State&, log_msg&, const std::tm&)
+    {}
+};
+}
+}
+}
+
+template<class Pattern>
+inline void spdlog::static_pattern_formatter<Pattern>::format(details::log_msg& msg)
+{
+    try
+    {
+        auto& tm_time = details::cached_localtime(msg.time);
+        details::static_pattern::runs<Pattern, 0, 0>::format(_state, msg, tm_time);
+        //write eol
+        msg.formatted.write(details::os::eol, details::os::eol_size);
+    }
+    catch(const fmt::FormatError& e)
+    {
+        throw spdlog_ex(fmt::format("formatting error while processing format string: {}", e.what()));
+    }
+}
@@ -0,0 +1,77 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+// Strings handed back and forth between the logging threads and the async worker.
+// Released strings keep their capacity, so once the pool is warm, acquiring one and
+// assigning text to it allocates nothing. The free strings are kept in a lock free queue,
+// so the threads logging long messages do not contend on a lock either.
+
+#include <spdlog/details/mpmc_bounded_q.h>
+
+#include <cstddef>
+#include <string>
+
+namespace spdlog
+{
+namespace details
+{
+
+class string_pool
+{
+public:
+    // max_pooled: max number of free strings kept, rounded up to a power of two
+    // max_capacity: strings grown over this capacity are freed instead of pooled
+    string_pool(size_t max_pooled, size_t max_capacity) :
+        _max_capacity(max_capacity),
+        _free(pool_size(max_pooled))
+    {}
+
+    ~string_pool()
+    {
+        std::string* s;
+        while (_free.dequeue(s))
+            delete s;
+    }
+
+    string_pool(const string_pool&) = delete;
+    string_pool& operator=(const string_pool&) = delete;
+
+    // an empty string to be given back with release()
+    std::string* acquire()
+    {
+        std::string* s;
+        if (_free.dequeue(s))
+            return s;
+        return new std::string();
+    }
+
+    void release(std::string* s)
+    {
+        if (s->capacity() <= _max_capacity)
+        {
+            s->clear();
+            if (_free.enqueue(std::move(s)))
+                return;
+        }
+        delete s;
+    }
+
+private:
+    static size_t pool_size(size_t max_pooled)
+    {
+        size_t size = 2;
+        while (size < max_pooled)
+            size *= 2;
+        return size;
+    }
+
+    const size_t _max_capacity;
+    mpmc_bounded_queue<std::string*> _free;
+};
+
+}
+}
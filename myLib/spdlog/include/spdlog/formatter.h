@@ -16,6 +16,7 @@ namespace spdlog
 namespace details
 {
 class flag_formatter;
+template<class Pattern> struct static_pattern_state;
 }
 
 class formatter
@@ -38,8 +39,29 @@ private:
     std::vector<std::unique_ptr<details::flag_formatter>> _formatters;
     void handle_flag(char flag);
     void compile_pattern(const std::string& pattern);
+    void cache_per_second_runs();
+};
+
+//
+// Pattern formatter parsed at compile time: the flags expand into one inlined function, without
+// a virtual call and a heap object per flag. Pattern is a type with a constexpr pattern() function:
+//     struct my_pattern { static constexpr const char* pattern() { return "[%H:%M:%S.%e] %v"; } };
+//     logger->set_formatter(std::make_shared<spdlog::static_pattern_formatter<my_pattern>>());
+// The flags are the ones of pattern_formatter, which remains the formatter of patterns known at runtime.
+//
+template<class Pattern>
+class static_pattern_formatter : public formatter
+{
+public:
+    static_pattern_formatter() = default;
+    static_pattern_formatter(const static_pattern_formatter&) = delete;
+    static_pattern_formatter& operator=(const static_pattern_formatter&) = delete;
+    void format(details::log_msg& msg) override;
+private:
+    details::static_pattern_state<Pattern> _state;
 };
 }
 
 #include <spdlog/details/pattern_formatter_impl.h>
+#include <spdlog/details/static_pattern_formatter_impl.h>
 
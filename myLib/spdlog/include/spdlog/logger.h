@@ -16,6 +16,7 @@
 #include <spdlog/common.h>
 #include <spdlog/details/line_logger_fwd.h>
 
+#include <atomic>
 #include <vector>
 #include <memory>
 #include <string>
@@ -108,6 +109,8 @@ protected:
     formatter_ptr _formatter;
     spdlog::level_t _level;
     spdlog::level_t _flush_level;
+    // formatting of the messages left to the async worker, see async_logger::set_deferred_formatting
+    std::atomic<bool> _deferred_formatting;
 };
 }
 
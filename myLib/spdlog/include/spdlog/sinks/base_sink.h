@@ -14,6 +14,7 @@
 #include <spdlog/formatter.h>
 #include <spdlog/common.h>
 #include <spdlog/details/log_msg.h>
+#include <spdlog/details/log_batch.h>
 
 #include <mutex>
 
@@ -37,8 +38,21 @@ public:
         _sink_it(msg);
     }
 
+    void log_batch(const details::log_batch& batch) override
+    {
+        std::lock_guard<Mutex> lock(_mutex);
+        _sink_batch(batch);
+    }
+
 protected:
     virtual void _sink_it(const details::log_msg& msg) = 0;
+
+    // sinks writing to a stream can write batch.formatted() at once instead
+    virtual void _sink_batch(const details::log_batch& batch)
+    {
+        for (auto& msg : batch)
+            _sink_it(msg);
+    }
     Mutex _mutex;
 };
 }
@@ -35,6 +35,12 @@ protected:
             (*iter)->log(msg);
     }
 
+    void _sink_batch(const details::log_batch& batch) override
+    {
+        for (auto iter = _sinks.begin(); iter != _sinks.end(); iter++)
+            (*iter)->log_batch(batch);
+    }
+
     std::vector<std::shared_ptr<sink>> _sinks;
 
 public:
@@ -0,0 +1,78 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/details/null_mutex.h>
+#include <spdlog/details/fd_file_helper.h>
+
+#include <mutex>
+#include <string>
+
+namespace spdlog
+{
+namespace sinks
+{
+/*
+* File sink writing straight to a file descriptor, without stdio (posix only)
+* Messages are gathered in a large buffer of its own and handed to the kernel with a single syscall
+* once it is full, or on flush(). fdatasync is called according to the durability policy.
+* A durability_policy::every_ms sync is only checked on a message or a flush: use an async logger
+* with a flush interval, or flush periodically, so the last messages do not wait for the next one.
+*/
+template<class Mutex>
+class fd_file_sink : public base_sink < Mutex >
+{
+public:
+    explicit fd_file_sink(const filename_t &filename,
+                          const durability_policy& durability = durability_policy(),
+                          size_t buffer_size = SPDLOG_FD_BUFFER_SIZE) :
+        _file_helper(durability, buffer_size)
+    {
+        _file_helper.open(filename);
+    }
+
+    void flush() override
+    {
+        std::lock_guard<Mutex> lock(base_sink<Mutex>::_mutex);
+        _file_helper.flush();
+    }
+
+    // flush and wait for the data to be on disk, whatever the durability policy
+    void sync()
+    {
+        std::lock_guard<Mutex> lock(base_sink<Mutex>::_mutex);
+        _file_helper.sync();
+    }
+
+    fd_file_stats stats()
+    {
+        std::lock_guard<Mutex> lock(base_sink<Mutex>::_mutex);
+        return _file_helper.stats();
+    }
+
+protected:
+    void _sink_it(const details::log_msg& msg) override
+    {
+        _file_helper.write(msg);
+    }
+
+    void _sink_batch(const details::log_batch& batch) override
+    {
+        _file_helper.write(batch.formatted().data(), batch.formatted().size());
+    }
+private:
+    details::fd_file_helper _file_helper;
+};
+
+typedef fd_file_sink<std::mutex> fd_file_sink_mt;
+typedef fd_file_sink<details::null_mutex> fd_file_sink_st;
+}
+}
+
+#endif
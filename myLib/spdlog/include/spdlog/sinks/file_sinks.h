@@ -12,10 +12,14 @@
 
 #include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <ctime>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 
 namespace spdlog
 {
@@ -44,6 +48,11 @@ protected:
     {
         _file_helper.write(msg);
     }
+
+    void _sink_batch(const details::log_batch& batch) override
+    {
+        _file_helper.write(batch.formatted().data(), batch.formatted().size());
+    }
 private:
     details::file_helper _file_helper;
 };
@@ -53,6 +62,12 @@ typedef simple_file_sink<details::null_mutex> simple_file_sink_st;
 
 /*
 * Rotating file sink based on size
+* With rotation_mode::background, the sink keeps the next file open in advance under a temporary name.
+* Rotating only switches to it, and a thread of the sink closes the full file, renames the files
+* and opens the next one meanwhile. Errors of that thread are thrown by the next rotation.
+* A next file left with messages by a crash is recovered by the constructor, finishing its rotation.
+* on_rotated, if set, is called with the name of each file rotated out (base.1.ext), for instance
+* to compress it. It must leave the file under the same name.
 */
 template<class Mutex>
 class rotating_file_sink : public base_sink < Mutex >
@@ -60,21 +75,63 @@ class rotating_file_sink : public base_sink < Mutex >
 public:
     rotating_file_sink(const filename_t &base_filename, const filename_t &extension,
                        std::size_t max_size, std::size_t max_files,
-                       bool force_flush = false) :
+                       bool force_flush = false,
+                       rotation_mode mode = rotation_mode::in_place,
+                       const std::function<void(const filename_t&)>& on_rotated = nullptr) :
         _base_filename(base_filename),
         _extension(extension),
         _max_size(max_size),
         _max_files(max_files),
         _current_size(0),
-        _file_helper(force_flush)
+        _force_flush(force_flush),
+        _on_rotated(on_rotated),
+        _file_helper(new details::file_helper(force_flush)),
+        _rotation_pending(false),
+        _stop(false)
+    {
+        _recover_next_file();
+        _file_helper->open(calc_filename(_base_filename, 0, _extension));
+        _current_size = _file_helper->size(); //expensive. called only once
+#ifndef _WIN32 // renaming open files is not allowed on windows
+        if (mode == rotation_mode::background)
+        {
+            _next_file = _open_next_file();
+            _rotation_thread = std::thread(&rotating_file_sink::_rotation_loop, this);
+        }
+#else
+        (void)mode;
+#endif
+    }
+
+    ~rotating_file_sink()
     {
-        _file_helper.open(calc_filename(_base_filename, 0, _extension));
-        _current_size = _file_helper.size(); //expensive. called only once
+        if (!_rotation_thread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(_rotation_mutex);
+            _stop = true;
+        }
+        _rotation_requested.notify_one();
+        _rotation_thread.join();
+        if (_next_file)
+        {
+            _next_file->close();
+            details::os::remove(_next_file->filename());
+        }
     }
 
     void flush() override
     {
-        _file_helper.flush();
+        // the file is switched by rotations
+        std::lock_guard<Mutex> lock(base_sink<Mutex>::_mutex);
+        _file_helper->flush();
+    }
+
+    // wait for the background thread to finish renaming the files of the last rotation
+    void wait_rotation()
+    {
+        std::unique_lock<std::mutex> lock(_rotation_mutex);
+        _rotation_done.wait(lock, [this] { return !_rotation_pending; });
     }
 
 protected:
@@ -83,10 +140,22 @@ protected:
         _current_size += msg.formatted.size();
         if (_current_size > _max_size)
         {
-            _rotate();
+            if (_rotation_thread.joinable())
+                _switch_file();
+            else
+                _rotate();
             _current_size = msg.formatted.size();
         }
-        _file_helper.write(msg);
+        _file_helper->write(msg);
+    }
+
+    void _sink_batch(const details::log_batch& batch) override
+    {
+        // rotation has to happen on the exact message crossing the limit
+        if (_current_size + batch.formatted().size() > _max_size)
+            return base_sink<Mutex>::_sink_batch(batch);
+        _current_size += batch.formatted().size();
+        _file_helper->write(batch.formatted().data(), batch.formatted().size());
     }
 
 private:
@@ -107,9 +176,17 @@ private:
     // log.3.txt -> delete
 
     void _rotate()
+    {
+        _file_helper->close();
+        _rename_files();
+        _file_helper->open(calc_filename(_base_filename, 0, _extension), true);
+        if (_on_rotated && _max_files)
+            _on_rotated(calc_filename(_base_filename, 1, _extension));
+    }
+
+    void _rename_files()
     {
         using details::os::filename_to_str;
-        _file_helper.close();
         for (auto i = _max_files; i > 0; --i)
         {
             filename_t src = calc_filename(_base_filename, i - 1, _extension);
@@ -127,14 +204,136 @@ private:
                 throw spdlog_ex("rotating_file_sink: failed renaming " + filename_to_str(src) + " to " + filename_to_str(target));
             }
         }
-        _file_helper.reopen(true);
     }
+
+    // log.next.txt
+    filename_t _next_file_name() const
+    {
+        std::conditional<std::is_same<filename_t::value_type, char>::value, fmt::MemoryWriter, fmt::WMemoryWriter>::type w;
+        w.write(SPDLOG_FILENAME_T("{}.next.{}"), _base_filename, _extension);
+        return w.str();
+    }
+
+    // a crash between the switch to log.next.txt and its rename leaves the newest messages there:
+    // finish that rotation, unless log.txt was already renamed
+    void _recover_next_file()
+    {
+        auto next_name = _next_file_name();
+        if (!details::file_helper::file_exists(next_name))
+            return;
+        details::file_helper next(false);
+        next.open(next_name);
+        auto next_size = next.size();
+        next.close();
+        if (next_size == 0)
+        {
+            details::os::remove(next_name);
+            return;
+        }
+
+        auto current = calc_filename(_base_filename, 0, _extension);
+        bool rotate = details::file_helper::file_exists(current);
+        if (rotate)
+            _rename_files();
+        if (details::os::rename(next_name, current))
+            throw spdlog_ex("rotating_file_sink: failed renaming " + details::os::filename_to_str(next_name) + " to " + details::os::filename_to_str(current));
+        if (rotate && _on_rotated && _max_files)
+            _on_rotated(calc_filename(_base_filename, 1, _extension));
+    }
+
+    std::unique_ptr<details::file_helper> _open_next_file()
+    {
+        std::unique_ptr<details::file_helper> next(new details::file_helper(_force_flush));
+        next->open(_next_file_name(), true);
+        return next;
+    }
+
+    // background rotation: switch to the next file, and leave the full one to the rotation thread
+    void _switch_file()
+    {
+        std::unique_lock<std::mutex> lock(_rotation_mutex);
+        // only waits when rotating again before the thread is done with the previous rotation
+        _rotation_done.wait(lock, [this] { return !_rotation_pending; });
+        if (!_rotation_error.empty())
+        {
+            std::string error;
+            error.swap(_rotation_error);
+            throw spdlog_ex(error);
+        }
+        if (!_next_file)
+        {
+            // the thread failed opening it: rotate here
+            lock.unlock();
+            return _rotate();
+        }
+        _full_file = std::move(_file_helper);
+        _file_helper = std::move(_next_file);
+        _rotation_pending = true;
+        lock.unlock();
+        _rotation_requested.notify_one();
+    }
+
+    void _rotation_loop()
+    {
+        std::unique_lock<std::mutex> lock(_rotation_mutex);
+        for (;;)
+        {
+            _rotation_requested.wait(lock, [this] { return _rotation_pending || _stop; });
+            if (!_rotation_pending)
+                return;
+            auto full_file = std::move(_full_file);
+            lock.unlock();
+
+            // without a next file, the next rotation happens in place
+            std::string error;
+            std::unique_ptr<details::file_helper> next_file;
+            try
+            {
+                full_file->close();
+                _rename_files();
+                auto current = calc_filename(_base_filename, 0, _extension);
+                if (details::os::rename(_next_file_name(), current))
+                    throw spdlog_ex("rotating_file_sink: failed renaming " + details::os::filename_to_str(_next_file_name()) + " to " + details::os::filename_to_str(current));
+                next_file = _open_next_file();
+                if (_on_rotated && _max_files)
+                    _on_rotated(calc_filename(_base_filename, 1, _extension));
+            }
+            catch (const std::exception& ex)
+            {
+                error = ex.what();
+            }
+            catch (...)
+            {
+                error = "rotating_file_sink: unknown exception during rotation";
+            }
+
+            lock.lock();
+            _next_file = std::move(next_file);
+            _rotation_error = error;
+            _rotation_pending = false;
+            _rotation_done.notify_all();
+        }
+    }
+
     filename_t _base_filename;
     filename_t _extension;
     std::size_t _max_size;
     std::size_t _max_files;
     std::size_t _current_size;
-    details::file_helper _file_helper;
+    bool _force_flush;
+    std::function<void(const filename_t&)> _on_rotated;
+    std::unique_ptr<details::file_helper> _file_helper;
+
+    // background rotation, guarded by _rotation_mutex
+    std::mutex _rotation_mutex;
+    std::condition_variable _rotation_requested;
+    std::condition_variable _rotation_done;
+    std::unique_ptr<details::file_helper> _next_file;
+    std::unique_ptr<details::file_helper> _full_file;
+    bool _rotation_pending;
+    bool _stop;
+    std::string _rotation_error;
+    std::thread _rotation_thread;
 };
 
 typedef rotating_file_sink<std::mutex> rotating_file_sink_mt;
@@ -202,16 +401,27 @@ public:
 
 protected:
     void _sink_it(const details::log_msg& msg) override
+    {
+        _rotate_if_due();
+        _file_helper.write(msg);
+    }
+
+    void _sink_batch(const details::log_batch& batch) override
+    {
+        _rotate_if_due();
+        _file_helper.write(batch.formatted().data(), batch.formatted().size());
+    }
+
+private:
+    void _rotate_if_due()
     {
         if (std::chrono::system_clock::now() >= _rotation_tp)
         {
             _file_helper.open(FileNameCalc::calc_filename(_base_filename, _extension));
             _rotation_tp = _next_rotation_tp();
         }
-        _file_helper.write(msg);
     }
 
-private:
     std::chrono::system_clock::time_point _next_rotation_tp()
     {
         using namespace std::chrono;
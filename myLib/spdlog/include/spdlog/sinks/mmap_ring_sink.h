@@ -0,0 +1,68 @@
+//
+// Copyright(c) 2015 Gabi Melman.
+// Distributed under the MIT License (http://opensource.org/licenses/MIT)
+//
+
+#pragma once
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#include <spdlog/sinks/base_sink.h>
+#include <spdlog/details/null_mutex.h>
+#include <spdlog/details/mmap_ring_helper.h>
+
+#include <mutex>
+#include <string>
+
+namespace spdlog
+{
+namespace sinks
+{
+/*
+* Circular log in a memory mapped file of fixed size (posix only)
+* Keeps the last capacity bytes of messages: logging is a copy into the mapping, without syscalls,
+* and the messages survive a crash of the process. Read the file back with mmap_ring_sink::read().
+*/
+template<class Mutex>
+class mmap_ring_sink : public base_sink < Mutex >
+{
+public:
+    mmap_ring_sink(const filename_t &filename, std::size_t capacity, bool truncate = false)
+    {
+        _ring.open(filename, capacity, truncate);
+    }
+
+    // the messages are in the mapping already
+    void flush() override
+    {
+    }
+
+    // wait for the messages to be on disk, to survive a crash of the system
+    void sync()
+    {
+        std::lock_guard<Mutex> lock(base_sink<Mutex>::_mutex);
+        _ring.sync();
+    }
+
+    // messages of a ring file, oldest first
+    static std::string read(const filename_t &filename)
+    {
+        return details::mmap_ring_helper::read(filename);
+    }
+
+protected:
+    void _sink_it(const details::log_msg& msg) override
+    {
+        _ring.write(msg);
+    }
+
+private:
+    details::mmap_ring_helper _ring;
+};
+
+typedef mmap_ring_sink<std::mutex> mmap_ring_sink_mt;
+typedef mmap_ring_sink<details::null_mutex> mmap_ring_sink_st;
+}
+}
+
+#endif
@@ -32,6 +32,13 @@ protected:
             _ostream.flush();
     }
 
+    void _sink_batch(const details::log_batch& batch) override
+    {
+        _ostream.write(batch.formatted().data(), batch.formatted().size());
+        if (_force_flush)
+            _ostream.flush();
+    }
+
     void flush() override
     {
         _ostream.flush();
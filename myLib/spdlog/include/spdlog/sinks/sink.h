@@ -7,6 +7,7 @@
 #pragma once
 
 #include <spdlog/details/log_msg.h>
+#include <spdlog/details/log_batch.h>
 
 namespace spdlog
 {
@@ -17,6 +18,12 @@ class sink
 public:
     virtual ~sink() {}
     virtual void log(const details::log_msg& msg) = 0;
+    // messages drained at once by an async logger, logged one by one unless overridden
+    virtual void log_batch(const details::log_batch& batch)
+    {
+        for (auto& msg : batch)
+            log(msg);
+    }
     virtual void flush() = 0;
 };
 }
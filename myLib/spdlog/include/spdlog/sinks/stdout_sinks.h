@@ -34,6 +34,12 @@ public:
         flush();
     }
 
+    void _sink_batch(const details::log_batch& batch) override
+    {
+        fwrite(batch.formatted().data(), sizeof(char), batch.formatted().size(), stdout);
+        flush();
+    }
+
     void flush() override
     {
         fflush(stdout);
@@ -62,6 +68,12 @@ public:
         flush();
     }
 
+    void _sink_batch(const details::log_batch& batch) override
+    {
+        fwrite(batch.formatted().data(), sizeof(char), batch.formatted().size(), stderr);
+        flush();
+    }
+
     void flush() override
     {
         fflush(stderr);
@@ -50,6 +50,10 @@ void set_level(level::level_enum log_level);
 // async_overflow_policy (optional, block_retry by default):
 //    async_overflow_policy::block_retry - if queue is full, block until queue has room for the new log entry.
 //    async_overflow_policy::discard_log_msg - never block and discard any new messages when queue  overflows.
+//    async_overflow_policy::overrun_oldest - never block and discard the oldest message in the queue instead (mpmc queue_type only).
+//    async_overflow_policy::discard_below_level - never block, discard new messages below warn and keep the others in the priority queue.
+//    With every policy, critical messages which do not fit in the queue go to a small priority queue the worker drains first.
+//    The number of messages dropped is reported periodically by a warning logged to the sinks.
 //
 // worker_warmup_cb (optional):
 //     callback function that will be called in worker thread upon start (can be used to init stuff like thread affinity)
@@ -57,16 +61,29 @@ void set_level(level::level_enum log_level);
 // worker_teardown_cb (optional):
 //     callback function that will be called in worker thread upon exit
 //
-void set_async_mode(size_t queue_size, const async_overflow_policy overflow_policy = async_overflow_policy::block_retry, const std::function<void()>& worker_warmup_cb = nullptr, const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero(), const std::function<void()>& worker_teardown_cb = nullptr);
+// queue_type (optional, mpmc by default):
+//    async_queue_type::mpmc - one lock free queue shared by all the logging threads.
+//    async_queue_type::mpsc - same, but the worker thread takes messages without compare and swap loops.
+//    async_queue_type::per_thread - each logging thread pushes to its own single producer queue of queue_size entries,
+//        so threads never contend with each other. Best with few long lived logging threads and a smaller queue_size.
+//
+// workers (optional, per_logger by default):
+//    async_workers::per_logger - one worker thread formats and writes the messages to all the sinks of the logger.
+//    async_workers::per_sink - each sink gets its own worker thread and queue: a slow sink only delays itself,
+//        and formatting runs on several threads. Sinks put together in a dist_sink share a worker.
+//        Requires an overflow_policy other than block_retry, the messages a slow sink cannot keep up with are dropped.
+//
+void set_async_mode(size_t queue_size, const async_overflow_policy overflow_policy = async_overflow_policy::block_retry, const std::function<void()>& worker_warmup_cb = nullptr, const std::chrono::milliseconds& flush_interval_ms = std::chrono::milliseconds::zero(), const std::function<void()>& worker_teardown_cb = nullptr, const async_queue_type queue_type = async_queue_type::mpmc, const async_workers workers = async_workers::per_logger);
 
 // Turn off async mode
 void set_sync_mode();
 
 //
 // Create and register multi/single threaded rotating file logger
+// With rotation_mode::background, the files are renamed by a thread of the sink instead of the logging thread.
 //
-std::shared_ptr<logger> rotating_logger_mt(const std::string& logger_name, const filename_t& filename, size_t max_file_size, size_t max_files, bool force_flush = false);
-std::shared_ptr<logger> rotating_logger_st(const std::string& logger_name, const filename_t& filename, size_t max_file_size, size_t max_files, bool force_flush = false);
+std::shared_ptr<logger> rotating_logger_mt(const std::string& logger_name, const filename_t& filename, size_t max_file_size, size_t max_files, bool force_flush = false, rotation_mode mode = rotation_mode::in_place);
+std::shared_ptr<logger> rotating_logger_st(const std::string& logger_name, const filename_t& filename, size_t max_file_size, size_t max_files, bool force_flush = false, rotation_mode mode = rotation_mode::in_place);
 
 //
 // Create file logger which creates new file on the given time (default in  midnight):
@@ -112,6 +129,14 @@ void drop(const std::string &name);
 // Drop all references
 void drop_all();
 
+//
+// Drop all references after stopping the async loggers within the deadline: their queued messages are
+// written until then, the rest and the messages logged afterwards are discarded. Sync loggers are flushed.
+// Never waits past the deadline, a worker stuck in a sink is left to finish on its own.
+// Example: auto report = spdlog::shutdown(std::chrono::steady_clock::now() + std::chrono::seconds(2));
+//
+shutdown_report shutdown(const std::chrono::steady_clock::time_point& deadline);
+
 
 ///////////////////////////////////////////////////////////////////////////////
 //
@@ -68,3 +68,37 @@
 // Uncomment to override default eol ("\n" or "\r\n" under Linux/Windows)
 // #define SPDLOG_EOL ";-)\n"
 ///////////////////////////////////////////////////////////////////////////////
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to change the max number of messages the async worker drains from the queue
+// and hands to the sinks at once (default 64). File sinks write a whole batch with one fwrite.
+// #define SPDLOG_ASYNC_BATCH_SIZE 64
+///////////////////////////////////////////////////////////////////////////////
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to change the size of the text stored in the async queue slots (default 104,
+// for queue cells of 128 bytes). Longer messages are copied to strings pooled by the logger instead.
+// #define SPDLOG_ASYNC_INLINE_MSG_SIZE 104
+///////////////////////////////////////////////////////////////////////////////
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to change the size of the async priority queue (default 64), taking critical messages
+// which do not fit in the main queue, and the messages kept by the discard_below_level policy.
+// #define SPDLOG_ASYNC_PRIORITY_QUEUE_SIZE 64
+///////////////////////////////////////////////////////////////////////////////
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to change the min interval between two warnings reporting messages dropped
+// on a full async queue (default 1000 ms). A report is also logged once the queue is empty.
+// #define SPDLOG_ASYNC_DROP_REPORT_INTERVAL_MS 1000
+///////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// Uncomment to change the default size of the buffer of fd_file_sink (default 256 KB).
+// Messages are written to the file with one syscall each time the buffer fills up.
+// #define SPDLOG_FD_BUFFER_SIZE (256 * 1024)
+///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,490 @@
+/*
+ * This content is released under the MIT License as specified in https://raw.githubusercontent.com/gabime/spdlog/master/LICENSE
+ */
+#include "includes.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+class counter_sink : public spdlog::sinks::sink
+{
+public:
+    void log(const spdlog::details::log_msg&) override
+    {
+        ++count;
+    }
+    void flush() override
+    {
+        ++flushes;
+    }
+
+    std::atomic<int> count {0};
+    std::atomic<int> flushes {0};
+};
+
+// checks the messages "<n>" of each thread arrive in order
+class order_sink : public spdlog::sinks::sink
+{
+public:
+    void log(const spdlog::details::log_msg& msg) override
+    {
+        int n = std::stoi(std::string(msg.raw.data(), msg.raw.size()));
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto last = _last.find(msg.thread_id);
+        if (last != _last.end() && last->second + 1 != n)
+            ordered = false;
+        _last[msg.thread_id] = n;
+        ++count;
+    }
+    void flush() override
+    {}
+
+    std::atomic<int> count {0};
+    std::atomic<bool> ordered {true};
+
+private:
+    std::mutex _mutex;
+    std::map<size_t, int> _last;
+};
+
+// keeps a copy of the last message
+class last_msg_sink : public spdlog::sinks::sink
+{
+public:
+    void log(const spdlog::details::log_msg& msg) override
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _last.reset(new spdlog::details::log_msg(msg));
+        ++count;
+    }
+    void flush() override
+    {}
+
+    spdlog::details::log_msg last()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return *_last;
+    }
+
+    std::atomic<int> count {0};
+
+private:
+    std::mutex _mutex;
+    std::unique_ptr<spdlog::details::log_msg> _last;
+};
+
+// keeps the text of the messages
+class lines_sink : public spdlog::sinks::sink
+{
+public:
+    void log(const spdlog::details::log_msg& msg) override
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _lines.emplace_back(msg.raw.data(), msg.raw.size());
+    }
+    void flush() override
+    {}
+
+    std::vector<std::string> lines()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _lines;
+    }
+
+private:
+    std::mutex _mutex;
+    std::vector<std::string> _lines;
+};
+
+// logs the messages with the worker held back, so they overflow a queue of 4
+std::vector<std::string> overflow_queue(spdlog::async_overflow_policy policy, const std::vector<std::pair<spdlog::level::level_enum, std::string>>& msgs)
+{
+    std::atomic<bool> go { false };
+    spdlog::drop_all();
+    spdlog::set_async_mode(4, policy, [&go]()
+    {
+        while (!go)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    auto sink = std::make_shared<lines_sink>();
+    {
+        auto logger = spdlog::create("logger", { sink });
+        logger->set_pattern("%v");
+        for (auto& msg : msgs)
+            logger->force_log(msg.first, msg.second.c_str());
+        go = true;
+        spdlog::drop("logger");
+    }
+    spdlog::set_sync_mode();
+    return sink->lines();
+}
+
+template<class Sink>
+bool wait_for_count(const Sink& sink, int expected, std::chrono::milliseconds timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (sink.count < expected && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    return sink.count >= expected;
+}
+}
+
+TEST_CASE("async_full_queue", "[async]")
+{
+    spdlog::drop_all();
+    spdlog::set_async_mode(2);
+    auto sink = std::make_shared<counter_sink>();
+    {
+        auto logger = spdlog::create("logger", { sink });
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&logger]()
+            {
+                for (int i = 0; i < 1000; ++i)
+                    logger->info("Test message {}", i);
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+        spdlog::drop("logger");
+    }
+    spdlog::set_sync_mode();
+    REQUIRE(sink->count == 4000);
+}
+
+TEST_CASE("async_wakeup_after_idle", "[async]")
+{
+    spdlog::drop_all();
+    spdlog::set_async_mode(128);
+    auto sink = std::make_shared<counter_sink>();
+    auto logger = spdlog::create("logger", { sink });
+    spdlog::set_sync_mode();
+
+    // long enough for the worker to block
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    logger->info("Test message");
+    REQUIRE(wait_for_count(*sink, 1, std::chrono::milliseconds(100)));
+    spdlog::drop("logger");
+}
+
+TEST_CASE("async_batch_to_file", "[async]")
+{
+    prepare_logdir();
+    std::string filename = "logs/async_batch_log.txt";
+    spdlog::set_async_mode(1024);
+    {
+        auto logger = spdlog::create<spdlog::sinks::simple_file_sink_mt>("logger", filename);
+        logger->set_pattern("%v");
+        for (int i = 0; i < 1000; ++i)
+            logger->info("Test message {}", i);
+        spdlog::drop("logger");
+    }
+    spdlog::set_sync_mode();
+    REQUIRE(count_lines(filename) == 1000);
+    auto contents = file_contents(filename);
+    REQUIRE(contents.compare(0, 15, "Test message 0\n") == 0);
+    REQUIRE(contents.compare(contents.size() - 17, 17, "Test message 999\n") == 0);
+}
+
+TEST_CASE("async_msg_fields", "[async]")
+{
+    spdlog::drop_all();
+    spdlog::set_async_mode(128);
+    auto sink = std::make_shared<last_msg_sink>();
+    auto logger = spdlog::create("async_fields_logger", { sink });
+    spdlog::set_sync_mode();
+    logger->set_level(spdlog::level::trace);
+
+    auto before = spdlog::details::os::now();
+    logger->warn("Test message");
+    auto after = spdlog::details::os::now();
+    logger->flush();
+    REQUIRE(wait_for_count(*sink, 1, std::chrono::milliseconds(1000)));
+    auto msg = sink->last();
+    spdlog::drop("async_fields_logger");
+
+    REQUIRE(msg.logger_name == "async_fields_logger");
+    REQUIRE(msg.level == spdlog::level::warn);
+    REQUIRE(msg.thread_id == spdlog::details::os::thread_id());
+    REQUIRE(msg.time >= before);
+    REQUIRE(msg.time <= after);
+    REQUIRE(std::string(msg.raw.data(), msg.raw.size()) == "Test message");
+}
+
+TEST_CASE("async_long_messages", "[async]")
+{
+    prepare_logdir();
+    std::string filename = "logs/async_long_log.txt";
+    std::string long_txt(SPDLOG_ASYNC_INLINE_MSG_SIZE * 3, 'x');
+    spdlog::set_async_mode(16);
+    {
+        auto logger = spdlog::create<spdlog::sinks::simple_file_sink_mt>("logger", filename);
+        logger->set_pattern("%n %v");
+        for (int i = 0; i < 100; ++i)
+        {
+            logger->info("short {}", i);
+            logger->info(long_txt);
+        }
+        spdlog::drop("logger");
+    }
+    spdlog::set_sync_mode();
+    REQUIRE(count_lines(filename) == 200);
+    auto contents = file_contents(filename);
+    REQUIRE(contents.compare(0, 15, "logger short 0\n") == 0);
+    REQUIRE(contents.compare(contents.size() - long_txt.size() - 8, long_txt.size() + 8, "logger " + long_txt + "\n") == 0);
+}
+
+TEST_CASE("async_queue_types", "[async]")
+{
+    using spdlog::async_queue_type;
+    for (auto queue_type : { async_queue_type::mpmc, async_queue_type::mpsc, async_queue_type::per_thread })
+    {
+        spdlog::drop_all();
+        spdlog::set_async_mode(4, spdlog::async_overflow_policy::block_retry, nullptr, std::chrono::milliseconds::zero(), nullptr, queue_type);
+        auto sink = std::make_shared<order_sink>();
+        {
+            auto logger = spdlog::create("logger", { sink });
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 4; ++t)
+            {
+                threads.emplace_back([&logger]()
+                {
+                    for (int i = 0; i < 1000; ++i)
+                        logger->info("{}", i);
+                });
+            }
+            for (auto& t : threads)
+                t.join();
+            spdlog::drop("logger");
+        }
+        spdlog::set_sync_mode();
+        REQUIRE(sink->count == 4000);
+        REQUIRE(sink->ordered);
+    }
+}
+
+TEST_CASE("async_overflow_policies", "[async]")
+{
+    using spdlog::level::level_enum;
+    using lines = std::vector<std::string>;
+    std::vector<std::pair<level_enum, std::string>> msgs;
+    for (int i = 0; i < 6; ++i)
+        msgs.emplace_back(spdlog::level::info, std::to_string(i));
+    msgs.emplace_back(spdlog::level::warn, "w");
+    msgs.emplace_back(spdlog::level::critical, "c");
+
+    REQUIRE(overflow_queue(spdlog::async_overflow_policy::discard_log_msg, msgs) ==
+            lines({ "c", "0", "1", "2", "3", "async logger dropped 3 messages on a full queue (info: 2, warning: 1)" }));
+    REQUIRE(overflow_queue(spdlog::async_overflow_policy::discard_below_level, msgs) ==
+            lines({ "w", "c", "0", "1", "2", "3", "async logger dropped 2 messages on a full queue (info: 2)" }));
+    REQUIRE(overflow_queue(spdlog::async_overflow_policy::overrun_oldest, msgs) ==
+            lines({ "c", "3", "4", "5", "w", "async logger dropped 3 messages on a full queue (info: 3)" }));
+
+    // off is a valid level for a message, its drops are counted too. 4 fill the queue, 64 the priority queue
+    msgs.assign(4 + SPDLOG_ASYNC_PRIORITY_QUEUE_SIZE + 2, { spdlog::level::off, "o" });
+    REQUIRE(overflow_queue(spdlog::async_overflow_policy::overrun_oldest, msgs).back() ==
+            "async logger dropped 2 messages on a full queue (off: 2)");
+
+    spdlog::set_async_mode(4, spdlog::async_overflow_policy::overrun_oldest, nullptr, std::chrono::milliseconds::zero(), nullptr, spdlog::async_queue_type::mpsc);
+    REQUIRE_THROWS_AS(spdlog::create("logger", { std::make_shared<lines_sink>() }), spdlog::spdlog_ex);
+    spdlog::set_sync_mode();
+}
+
+TEST_CASE("async_worker_per_sink", "[async]")
+{
+    // a sink stuck until released
+    class stuck_sink : public counter_sink
+    {
+    public:
+        void log(const spdlog::details::log_msg& msg) override
+        {
+            while (!released)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            counter_sink::log(msg);
+        }
+        std::atomic<bool> released {false};
+    };
+
+    spdlog::drop_all();
+    spdlog::set_async_mode(16, spdlog::async_overflow_policy::block_retry, nullptr, std::chrono::milliseconds::zero(), nullptr,
+                           spdlog::async_queue_type::mpmc, spdlog::async_workers::per_sink);
+    REQUIRE_THROWS_AS(spdlog::create("logger", { std::make_shared<counter_sink>() }), spdlog::spdlog_ex);
+
+    // the queue of the stuck sink fills up, its messages are dropped instead of blocking the other sink
+    spdlog::set_async_mode(16, spdlog::async_overflow_policy::discard_log_msg, nullptr, std::chrono::milliseconds::zero(), nullptr,
+                           spdlog::async_queue_type::mpmc, spdlog::async_workers::per_sink);
+    auto stuck = std::make_shared<stuck_sink>();
+    auto sink = std::make_shared<counter_sink>();
+    {
+        auto logger = spdlog::create("logger", { stuck, sink });
+        for (int i = 0; i < 100; ++i)
+        {
+            logger->info("Test message {}", i);
+            if (i % 10 == 9) // let the other worker keep up
+                REQUIRE(wait_for_count(*sink, i + 1, std::chrono::milliseconds(1000)));
+        }
+        REQUIRE(stuck->count == 0);
+        stuck->released = true;
+        spdlog::drop("logger");
+    }
+    spdlog::set_sync_mode();
+    REQUIRE(sink->count == 100);
+    REQUIRE(stuck->count > 0);
+    REQUIRE(stuck->count < 100);
+}
+
+TEST_CASE("async_deferred_formatting", "[async]")
+{
+    auto log_lines = [](bool deferred)
+    {
+        spdlog::drop_all();
+        spdlog::set_async_mode(16);
+        auto sink = std::make_shared<lines_sink>();
+        {
+            auto logger = std::static_pointer_cast<spdlog::async_logger>(spdlog::create("logger", { sink }));
+            logger->set_pattern("%v");
+            logger->set_deferred_formatting(deferred);
+            std::string txt = "some text";
+            char buf[16] = "buffer";
+            int n = 42;
+            logger->info("{} {} {}", 1, -2LL, 3u);
+            logger->info("{:.3f} {} {}", 3.14159, true, 'c');
+            logger->info("{} [{}] {}", txt, buf, std::string(SPDLOG_ASYNC_INLINE_MSG_SIZE, 'x'));
+            logger->info("{}", static_cast<const void*>(&n));
+            logger->info("{}", n) << " and " << n;
+            logger->info("{} {} {} {} {} {} {} {} {} {} {} {} {} {} {} {}", 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16);
+            std::string runtime_fmt = "runtime {} message";
+            logger->info(runtime_fmt.c_str(), n);
+            // the format string and the arguments are copied, later changes are not logged
+            txt = "changed";
+            buf[0] = 'B';
+            runtime_fmt.assign(runtime_fmt.size(), '?');
+            runtime_fmt.clear();
+            runtime_fmt.shrink_to_fit();
+            spdlog::drop("logger");
+        }
+        spdlog::set_sync_mode();
+        return sink->lines();
+    };
+    REQUIRE(log_lines(true) == log_lines(false));
+
+    // a bad format string can no longer throw to the caller, it is logged instead
+    spdlog::drop_all();
+    spdlog::set_async_mode(16);
+    auto sink = std::make_shared<lines_sink>();
+    {
+        auto logger = std::static_pointer_cast<spdlog::async_logger>(spdlog::create("logger", { sink }));
+        logger->set_pattern("%v");
+        logger->set_deferred_formatting(true);
+        logger->info("{} {}", 1);
+        spdlog::drop("logger");
+    }
+    spdlog::set_sync_mode();
+    REQUIRE(sink->lines().size() == 1);
+    REQUIRE(sink->lines()[0].find("formatting error while processing format string '{} {}'") == 0);
+}
+
+TEST_CASE("async_shutdown", "[async]")
+{
+    using clock = std::chrono::steady_clock;
+
+    // drained before the deadline
+    spdlog::drop_all();
+    spdlog::set_async_mode(128);
+    auto sink = std::make_shared<counter_sink>();
+    auto logger = spdlog::create("logger", { sink });
+    spdlog::set_sync_mode();
+    for (int i = 0; i < 100; ++i)
+        logger->info("Test message {}", i);
+    auto report = spdlog::shutdown(clock::now() + std::chrono::seconds(10));
+    REQUIRE(report.lost == 0);
+    REQUIRE(report.workers_abandoned == 0);
+    REQUIRE(sink->count == 100);
+    REQUIRE(spdlog::get("logger") == nullptr);
+    // a second call returns the same report
+    report = std::static_pointer_cast<spdlog::async_logger>(logger)->shutdown(clock::now());
+    REQUIRE(report.lost == 0);
+    REQUIRE(report.workers_abandoned == 0);
+    // discarded from now on
+    logger->info("Test message");
+    logger->flush();
+    REQUIRE(sink->count == 100);
+    logger.reset();
+
+    // a worker stuck in its warmup callback misses the deadline, and the client blocked on the full queue is released
+    std::atomic<bool> go { false };
+    spdlog::set_async_mode(4, spdlog::async_overflow_policy::block_retry, [&go]()
+    {
+        while (!go)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    sink = std::make_shared<counter_sink>();
+    logger = spdlog::create("logger", { sink });
+    spdlog::set_sync_mode();
+    std::thread client([&logger]()
+    {
+        for (int i = 0; i < 10; ++i)
+            logger->info("Test message {}", i);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    auto start = clock::now();
+    report = spdlog::shutdown(start + std::chrono::milliseconds(100));
+    auto elapsed = clock::now() - start;
+    client.join();
+    REQUIRE(report.workers_abandoned == 1);
+    REQUIRE(elapsed < std::chrono::seconds(1));
+    // the sinks are flushed by the caller
+    REQUIRE(sink->flushes == 1);
+    auto lost = report.lost;
+    report = std::static_pointer_cast<spdlog::async_logger>(logger)->shutdown(clock::now());
+    REQUIRE(report.workers_abandoned == 1);
+    REQUIRE(report.lost == lost);
+    logger.reset();
+    // the abandoned worker discards what it finds past the deadline
+    go = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    REQUIRE(sink->count == 0);
+    REQUIRE(sink->flushes == 1);
+
+    // a worker stuck in a sink misses the deadline, it does not call the other sink once released,
+    // and the caller flushes only the other sink
+    class stuck_sink : public counter_sink
+    {
+    public:
+        void log(const spdlog::details::log_msg& msg) override
+        {
+            entered = true;
+            while (!released)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            counter_sink::log(msg);
+        }
+        std::atomic<bool> entered {false};
+        std::atomic<bool> released {false};
+    };
+    spdlog::set_async_mode(128);
+    auto stuck = std::make_shared<stuck_sink>();
+    sink = std::make_shared<counter_sink>();
+    logger = spdlog::create("logger", { stuck, sink });
+    spdlog::set_sync_mode();
+    logger->info("Test message");
+    while (!stuck->entered)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    report = spdlog::shutdown(clock::now() + std::chrono::milliseconds(50));
+    REQUIRE(report.workers_abandoned == 1);
+    REQUIRE(stuck->flushes == 0);
+    REQUIRE(sink->flushes == 1);
+    logger.reset();
+    stuck->released = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    REQUIRE(stuck->count == 1);
+    REQUIRE(stuck->flushes == 0);
+    REQUIRE(sink->count == 0);
+    REQUIRE(sink->flushes == 1);
+}
@@ -2,6 +2,8 @@
  * This content is released under the MIT License as specified in https://raw.githubusercontent.com/gabime/spdlog/master/LICENSE
  */
 #include "includes.h"
+#include "../include/spdlog/sinks/fd_file_sink.h"
+#include "../include/spdlog/sinks/mmap_ring_sink.h"
 
 
 TEST_CASE("simple_file_logger", "[simple_logger]]")
@@ -58,6 +60,56 @@ TEST_CASE("rotating_file_logger2", "[rotating_logger]]")
 }
 
 
+TEST_CASE("rotating_file_logger_background", "[rotating_logger]]")
+{
+    prepare_logdir();
+    std::string basename = "logs/rotating_log";
+    std::atomic<int> rotated(0);
+    auto sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(basename, "txt", 1024, 2, false, spdlog::rotation_mode::background,
+                [&rotated](const spdlog::filename_t& filename)
+    {
+        REQUIRE(filename == "logs/rotating_log.1.txt");
+        ++rotated;
+    });
+    auto logger = std::make_shared<spdlog::logger>("logger", sink);
+    logger->set_pattern("%v");
+
+    // 17 bytes each: 60 lines per file
+    for (int i = 100; i < 400; i++)
+        logger->info("Test message {}", i);
+    logger->flush();
+    sink->wait_rotation();
+
+    REQUIRE(rotated == 4);
+    REQUIRE(count_lines(basename + ".txt") == 60);
+    REQUIRE(count_lines(basename + ".1.txt") == 60);
+    REQUIRE(count_lines(basename + ".2.txt") == 60);
+    REQUIRE(file_contents(basename + ".1.txt").substr(0, 17) == "Test message 280\n");
+    REQUIRE(file_contents(basename + ".txt").substr(0, 17) == "Test message 340\n");
+    REQUIRE(spdlog::details::file_helper::file_exists(basename + ".next.txt"));
+
+    logger.reset();
+    sink.reset();
+    REQUIRE(!spdlog::details::file_helper::file_exists(basename + ".next.txt"));
+
+    // a crash after switching to the next file: its rotation is finished on startup
+    std::ofstream(basename + ".txt") << "Test message 400\n";
+    std::ofstream(basename + ".next.txt") << "Test message 401\n";
+    sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(basename, "txt", 1024, 2, false, spdlog::rotation_mode::background);
+    REQUIRE(file_contents(basename + ".txt") == "Test message 401\n");
+    REQUIRE(file_contents(basename + ".1.txt") == "Test message 400\n");
+    REQUIRE(file_contents(basename + ".2.txt").substr(0, 17) == "Test message 280\n");
+    sink.reset();
+
+    // a crash after renaming the files: only the next file is renamed
+    spdlog::details::os::remove(basename + ".txt");
+    std::ofstream(basename + ".next.txt") << "Test message 402\n";
+    sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(basename, "txt", 1024, 2);
+    REQUIRE(file_contents(basename + ".txt") == "Test message 402\n");
+    REQUIRE(file_contents(basename + ".1.txt") == "Test message 400\n");
+    REQUIRE(!spdlog::details::file_helper::file_exists(basename + ".next.txt"));
+}
+
 TEST_CASE("daily_logger", "[daily_logger]]")
 {
 
@@ -130,3 +182,98 @@ TEST_CASE("daily_logger with custom calculator", "[daily_logger_custom]]")
     REQUIRE(count_lines(filename) == 10);
 }
 
+
+#if defined(__linux__) || defined(__APPLE__)
+TEST_CASE("fd_file_logger", "[fd_file_logger]]")
+{
+    prepare_logdir();
+    std::string filename = "logs/fd_log.txt";
+
+    auto sink = std::make_shared<spdlog::sinks::fd_file_sink_st>(filename, spdlog::durability_policy::none(), 64);
+    auto logger = std::make_shared<spdlog::logger>("logger", sink);
+    logger->set_pattern("%v");
+
+    for (int i = 0; i < 10; ++i)
+        logger->info("Test message {}", i);
+    // 15 bytes each: one write every 4 messages, once the 64 bytes buffer is full
+    REQUIRE(sink->stats().write_calls == 2);
+    logger->info("A message longer than the whole buffer of the sink, written along with the buffer {}", 10);
+    REQUIRE(sink->stats().write_calls == 3);
+    logger->info("Test message {}", 11);
+    logger->flush();
+
+    auto stats = sink->stats();
+    REQUIRE(stats.write_calls == 4);
+    REQUIRE(stats.sync_calls == 0);
+    REQUIRE(stats.bytes_written == get_filesize(filename));
+    REQUIRE(count_lines(filename) == 12);
+    REQUIRE(file_contents(filename).substr(0, 30) == "Test message 0\nTest message 1\n");
+
+    auto synced_sink = std::make_shared<spdlog::sinks::fd_file_sink_mt>(filename, spdlog::durability_policy::every_bytes(40));
+    auto synced_logger = std::make_shared<spdlog::logger>("synced_logger", synced_sink);
+    synced_logger->set_pattern("%v");
+    for (int i = 0; i < 10; ++i)
+        synced_logger->info("Test message {}", i);
+    REQUIRE(synced_sink->stats().sync_calls == 3);
+    synced_logger->flush();
+    REQUIRE(count_lines(filename) == 22);
+
+    // an every_ms sync left pending by the last message is done by the async worker flush
+    spdlog::drop_all();
+    spdlog::set_async_mode(128, spdlog::async_overflow_policy::block_retry, nullptr, std::chrono::milliseconds(10));
+    auto timed_sink = std::make_shared<spdlog::sinks::fd_file_sink_mt>(filename, spdlog::durability_policy::every_ms(20));
+    auto timed_logger = spdlog::create("timed_logger", { timed_sink });
+    spdlog::set_sync_mode();
+    timed_logger->set_pattern("%v");
+    timed_logger->info("Test message {}", 22);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    REQUIRE(timed_sink->stats().sync_calls == 1);
+    REQUIRE(count_lines(filename) == 23);
+    spdlog::drop_all();
+}
+
+TEST_CASE("mmap_ring_logger", "[mmap_ring_logger]]")
+{
+    prepare_logdir();
+    std::string filename = "logs/ring_log.bin";
+    auto expected = [](int from, int to)
+    {
+        std::string lines;
+        for (int i = from; i <= to; ++i)
+            lines += "Test message " + std::to_string(i) + "\n";
+        return lines;
+    };
+
+    auto logger = spdlog::create<spdlog::sinks::mmap_ring_sink_st>("logger", filename, 100);
+    logger->set_pattern("%v");
+    for (int i = 0; i < 3; ++i)
+        logger->info("Test message {}", i);
+    REQUIRE(spdlog::sinks::mmap_ring_sink_st::read(filename) == expected(0, 2));
+
+    // records of 4 + 15 bytes, then 4 + 16 bytes from message 10: the last 100 bytes hold messages 15 to 19
+    for (int i = 3; i < 20; ++i)
+        logger->info("Test message {}", i);
+    REQUIRE(spdlog::sinks::mmap_ring_sink_st::read(filename) == expected(15, 19));
+
+    // reopening continues the ring
+    spdlog::drop_all();
+    logger.reset();
+    logger = spdlog::create<spdlog::sinks::mmap_ring_sink_mt>("logger", filename, 100);
+    logger->set_pattern("%v");
+    logger->info("Test message {}", 20);
+    REQUIRE(spdlog::sinks::mmap_ring_sink_st::read(filename) == expected(16, 20));
+
+    spdlog::drop_all();
+    logger.reset();
+    logger = spdlog::create<spdlog::sinks::mmap_ring_sink_mt>("logger", filename, 100, true);
+    logger->set_pattern("%v");
+    logger->info("Test message {}", 21);
+    REQUIRE(spdlog::sinks::mmap_ring_sink_st::read(filename) == expected(21, 21));
+
+    // messages of several lines are kept or dropped whole: records of 4 + 24 bytes, the last 100 hold 3 of them
+    for (int i = 22; i < 30; ++i)
+        logger->info("Test message {}\n  at {}", i, i);
+    REQUIRE(spdlog::sinks::mmap_ring_sink_st::read(filename) ==
+            "Test message 27\n  at 27\nTest message 28\n  at 28\nTest message 29\n  at 29\n");
+}
+#endif
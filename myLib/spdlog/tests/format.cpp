@@ -86,3 +86,108 @@ TEST_CASE("invalid_format", "[format]")
 
 
 
+
+TEST_CASE("pattern_time_cache", "[format]")
+{
+    // formatted with the given pattern at seconds + millis since the epoch
+    std::string name = "logger";
+    auto format_at = [&name](spdlog::pattern_formatter& formatter, std::time_t seconds, int millis)
+    {
+        spdlog::details::log_msg msg(spdlog::level::info);
+        msg.logger_name = name;
+        msg.time = spdlog::log_clock::from_time_t(seconds) + std::chrono::milliseconds(millis);
+        msg.raw << "msg";
+        formatter.format(msg);
+        return std::string(msg.formatted.data(), msg.formatted.size() - spdlog::details::os::eol_size);
+    };
+    auto expected = [](const char* format, std::time_t seconds, const char* suffix)
+    {
+        char buf[64];
+        std::tm tm_time = spdlog::details::os::localtime(seconds);
+        std::strftime(buf, sizeof(buf), format, &tm_time);
+        return std::string(buf) + suffix;
+    };
+
+    // cached per second and per formatter, while formatters share the thread cache
+    spdlog::pattern_formatter custom("%Y-%m-%d %H:%M:%S.%e %v");
+    spdlog::pattern_formatter full("%+");
+    std::time_t t = 1445000000;
+    for (std::time_t seconds : { t, t, t + 1, t + 3600, t })
+    {
+        REQUIRE(format_at(custom, seconds, 7) == expected("%Y-%m-%d %H:%M:%S", seconds, ".007 msg"));
+        REQUIRE(format_at(full, seconds, 120) == expected("[%Y-%m-%d %H:%M:%S", seconds, ".120] [logger] [info] msg"));
+        REQUIRE(format_at(custom, seconds, 999) == expected("%Y-%m-%d %H:%M:%S", seconds, ".999 msg"));
+    }
+}
+
+namespace
+{
+struct full_pattern
+{
+    static constexpr const char* pattern()
+    {
+        return "%+";
+    }
+};
+struct date_pattern
+{
+    static constexpr const char* pattern()
+    {
+        return "[%Y-%m-%d %H:%M:%S.%e] [%n] [%l] %v";
+    }
+};
+struct mixed_pattern
+{
+    static constexpr const char* pattern()
+    {
+        return "%a %b %c %D %I:%M %p%r|%R|%T|%z|%L|%C %f %F %q %% %t %v trailing %";
+    }
+};
+
+template<class Pattern>
+void require_same_as_runtime(spdlog::details::log_msg& msg)
+{
+    spdlog::pattern_formatter runtime(Pattern::pattern());
+    spdlog::static_pattern_formatter<Pattern> compiled;
+    auto runtime_msg = msg;
+    auto compiled_msg = msg;
+    runtime.format(runtime_msg);
+    compiled.format(compiled_msg);
+    REQUIRE(compiled_msg.formatted.str() == runtime_msg.formatted.str());
+}
+}
+
+TEST_CASE("static_pattern_formatter", "[format]")
+{
+    std::string name = "logger";
+    spdlog::details::log_msg msg(spdlog::level::warn);
+    msg.logger_name = name;
+    msg.thread_id = 42;
+    msg.raw << "msg";
+    for (int i = 0; i < 3; ++i)
+    {
+        msg.time = spdlog::log_clock::from_time_t(1445000000 + i * 3599) + std::chrono::microseconds(123456);
+        require_same_as_runtime<full_pattern>(msg);
+        require_same_as_runtime<date_pattern>(msg);
+        require_same_as_runtime<mixed_pattern>(msg);
+    }
+}
+
+TEST_CASE("logger_name", "[format]")
+{
+    // a message without logger formats with an empty name
+    spdlog::details::log_msg msg(spdlog::level::info);
+    msg.raw << "msg";
+    spdlog::details::full_formatter().format(msg, spdlog::details::os::localtime());
+    REQUIRE(msg.logger_name.empty());
+    REQUIRE(msg.formatted.str().find("[] [info] msg") != std::string::npos);
+
+    // and reads like the string of the logger otherwise
+    std::string name = "logger";
+    msg.logger_name = name;
+    std::string copy = msg.logger_name;
+    REQUIRE(copy == "logger");
+    REQUIRE(msg.logger_name == name);
+    REQUIRE(msg.logger_name != "other");
+    REQUIRE(fmt::format("[{}]", msg.logger_name) == "[logger]");
+}
@@ -1,5 +1,10 @@
 #include "includes.h"
 
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
 static const char *logger_name = "null_logger";
 
 TEST_CASE("register_drop", "[registry]")
@@ -51,3 +56,44 @@ TEST_CASE("drop non existing" "[registry]")
     spdlog::drop_all();
 }
 
+
+TEST_CASE("drop_releases_logger", "[registry]")
+{
+    spdlog::drop_all();
+    std::weak_ptr<spdlog::logger> weak = spdlog::create<spdlog::sinks::null_sink_mt>(logger_name);
+    REQUIRE(spdlog::get(logger_name) != nullptr);
+    spdlog::drop(logger_name);
+    REQUIRE(weak.expired());
+}
+
+TEST_CASE("concurrent_get", "[registry]")
+{
+    spdlog::drop_all();
+    spdlog::create<spdlog::sinks::null_sink_mt>(logger_name);
+    std::atomic<bool> done { false };
+    std::atomic<bool> missing { false };
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t)
+    {
+        readers.emplace_back([&done, &missing]()
+        {
+            while (!done)
+            {
+                if (!spdlog::get(logger_name))
+                    missing = true;
+                spdlog::get("name2");
+            }
+        });
+    }
+    for (int i = 0; i < 200; ++i)
+    {
+        spdlog::create<spdlog::sinks::null_sink_mt>("name2");
+        spdlog::drop("name2");
+    }
+    done = true;
+    for (auto& t : readers)
+        t.join();
+    REQUIRE_FALSE(missing);
+    REQUIRE_FALSE(spdlog::get("name2"));
+    spdlog::drop_all();
+}
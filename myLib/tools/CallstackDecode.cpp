@@ -0,0 +1,344 @@
+// Host side decoder of binary callstack records (see CallstackRecord.h).
+//
+// Usage: callstack-decode [-b <dir with unstripped binaries>]... [-a <addr2line>] [log file]
+//
+// Reads a log (stdin by default), and prints every "@cs:" record found in it as frames.
+// Modules are matched against the binaries of the -b directories by build-id (by file name
+// when the build-id is unknown) and symbolized with addr2line.
+
+#include "CallstackRecord.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <elf.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+using namespace Navionics;
+
+namespace
+{
+
+std::string Hex(std::string const& bytes)
+{
+    std::ostringstream stream;
+    for (char c : bytes)
+    {
+        stream << std::hex << std::setfill('0') << std::setw(2)
+               << static_cast<unsigned>(static_cast<unsigned char>(c));
+    }
+    return stream.str();
+}
+
+template <typename Ehdr, typename Phdr, typename Nhdr>
+std::string ReadBuildId(std::ifstream& file)
+{
+    Ehdr header;
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        return std::string();
+    }
+    for (unsigned i = 0; i < header.e_phnum; ++i)
+    {
+        Phdr phdr;
+        file.seekg(header.e_phoff + i * sizeof(Phdr));
+        if (!file.read(reinterpret_cast<char*>(&phdr), sizeof(phdr)) || phdr.p_type != PT_NOTE)
+        {
+            continue;
+        }
+        std::vector<char> notes(phdr.p_filesz);
+        file.seekg(phdr.p_offset);
+        if (notes.empty() || !file.read(notes.data(), notes.size()))
+        {
+            continue;
+        }
+        char const* note = notes.data();
+        char const* end  = note + notes.size();
+        while (note + sizeof(Nhdr) <= end)
+        {
+            Nhdr const* nhdr = reinterpret_cast<Nhdr const*>(note);
+            char const* name = note + sizeof(Nhdr);
+            char const* desc = name + ((nhdr->n_namesz + 3) & ~3u);
+            if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 &&
+                std::memcmp(name, "GNU", 4) == 0 && desc + nhdr->n_descsz <= end)
+            {
+                return std::string(desc, nhdr->n_descsz);
+            }
+            note = desc + ((nhdr->n_descsz + 3) & ~3u);
+        }
+    }
+    return std::string();
+}
+
+// Returns false if path is not an ELF file
+bool ReadBuildId(std::string const& path, std::string& buildId)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    unsigned char ident[EI_NIDENT];
+    if (!file.read(reinterpret_cast<char*>(ident), sizeof(ident)) ||
+        std::memcmp(ident, ELFMAG, SELFMAG) != 0)
+    {
+        return false;
+    }
+    // device binaries are often 32 bit while the host is 64 bit
+    buildId = (ident[EI_CLASS] == ELFCLASS64) ? ReadBuildId<Elf64_Ehdr, Elf64_Phdr, Elf64_Nhdr>(file)
+                                              : ReadBuildId<Elf32_Ehdr, Elf32_Phdr, Elf32_Nhdr>(file);
+    return true;
+}
+
+class Binaries
+{
+public:
+    void AddDirectory(std::string const& directory)
+    {
+        DIR* dir = opendir(directory.c_str());
+        if (dir == nullptr)
+        {
+            std::cerr << "cannot open " << directory << std::endl;
+            return;
+        }
+        while (dirent* entry = readdir(dir))
+        {
+            std::string path = directory + "/" + entry->d_name;
+            std::string buildId;
+            if (entry->d_name[0] != '.' && ReadBuildId(path, buildId))
+            {
+                if (!buildId.empty())
+                {
+                    m_byBuildId[buildId] = path;
+                }
+                m_byName[entry->d_name] = path;
+            }
+        }
+        closedir(dir);
+    }
+
+    std::string Find(CallstackRecord::Module const& module) const
+    {
+        if (!module.BuildId.empty())
+        {
+            std::map<std::string, std::string>::const_iterator it = m_byBuildId.find(module.BuildId);
+            return (it != m_byBuildId.end()) ? it->second : std::string();
+        }
+        std::map<std::string, std::string>::const_iterator it = m_byName.find(module.Name);
+        return (it != m_byName.end()) ? it->second : std::string();
+    }
+
+private:
+    std::map<std::string, std::string> m_byBuildId;
+    std::map<std::string, std::string> m_byName;
+};
+
+// "function at file:line" for each offset as reported by addr2line, empty on failure.
+// One addr2line process for all the offsets of a binary; it is started without a shell,
+// so the paths are passed as they are.
+std::vector<std::string> Symbolize(std::string const& addr2line, std::string const& binary,
+                                   std::vector<std::uint64_t> const& offsets)
+{
+    std::vector<std::string> symbols(offsets.size());
+    std::vector<std::string> arguments = {addr2line, "-C", "-f", "-e", binary};
+    for (std::uint64_t offset : offsets)
+    {
+        std::ostringstream argument;
+        argument << "0x" << std::hex << offset;
+        arguments.push_back(argument.str());
+    }
+    std::vector<char*> argv;
+    for (std::string& argument : arguments)
+    {
+        argv.push_back(&argument[0]);
+    }
+    argv.push_back(nullptr);
+
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return symbols;
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    posix_spawn_file_actions_addclose(&actions, fds[1]);
+    pid_t pid     = 0;
+    int   spawned = posix_spawnp(&pid, addr2line.c_str(), &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (spawned != 0)
+    {
+        close(fds[0]);
+        std::cerr << "cannot run " << addr2line << ": " << std::strerror(spawned) << std::endl;
+        return symbols;
+    }
+
+    // two lines per offset: the function, then file:line
+    FILE*       output = fdopen(fds[0], "r");
+    char        line[4096];
+    std::size_t index = 0;
+    while (output != nullptr && index < symbols.size() && std::fgets(line, sizeof(line), output) != nullptr)
+    {
+        std::string function(line, std::strcspn(line, "\n"));
+        std::string location;
+        if (std::fgets(line, sizeof(line), output) != nullptr)
+        {
+            location.assign(line, std::strcspn(line, "\n"));
+        }
+        if (!function.empty())
+        {
+            symbols[index] = function + " at " + location;
+        }
+        ++index;
+    }
+    if (output != nullptr)
+    {
+        fclose(output);
+    }
+    else
+    {
+        close(fds[0]);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return symbols;
+}
+
+void Print(CallstackRecord const& record, Binaries const& binaries, std::string const& addr2line)
+{
+    // every frame, the first included, holds the return address of a call (_Unwind_GetIP),
+    // which may already belong to the next line or function: look up the call instead
+    std::vector<std::string> symbols(record.Frames.size());
+    std::map<std::string, std::vector<std::size_t>> framesByBinary;
+    for (std::size_t i = 0; i < record.Frames.size(); ++i)
+    {
+        std::size_t module = record.Frames[i].Module;
+        if (module < record.Modules.size())
+        {
+            std::string binary = binaries.Find(record.Modules[module]);
+            if (!binary.empty())
+            {
+                framesByBinary[binary].push_back(i);
+            }
+        }
+    }
+    for (auto const& binary : framesByBinary)
+    {
+        std::vector<std::uint64_t> offsets;
+        for (std::size_t i : binary.second)
+        {
+            offsets.push_back(record.Frames[i].Offset - 1);
+        }
+        std::vector<std::string> resolved = Symbolize(addr2line, binary.first, offsets);
+        for (std::size_t j = 0; j < binary.second.size(); ++j)
+        {
+            symbols[binary.second[j]] = resolved[j];
+        }
+    }
+
+    for (std::size_t i = 0; i < record.Frames.size(); ++i)
+    {
+        CallstackRecord::Frame const& frame = record.Frames[i];
+        std::cout << '#' << std::setfill('0') << std::setw(2) << std::dec << i << ' ';
+        if (frame.Module >= record.Modules.size())
+        {
+            std::cout << "<unknown> 0x" << std::hex << frame.Offset << std::endl;
+            continue;
+        }
+
+        CallstackRecord::Module const& module = record.Modules[frame.Module];
+        std::cout << module.Name << "+0x" << std::hex << frame.Offset;
+        if (!symbols[i].empty())
+        {
+            std::cout << ' ' << symbols[i];
+        }
+        else if (binaries.Find(module).empty() && !module.BuildId.empty())
+        {
+            std::cout << " (build-id " << Hex(module.BuildId) << ')';
+        }
+        std::cout << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Binaries    binaries;
+    std::string addr2line = "addr2line";
+    std::string input;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+        {
+            binaries.AddDirectory(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+        {
+            addr2line = argv[++i];
+        }
+        else if (argv[i][0] != '-' && input.empty())
+        {
+            input = argv[i];
+        }
+        else
+        {
+            std::cerr << "usage: " << argv[0]
+                      << " [-b <binaries dir>]... [-a <addr2line>] [log file]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::ifstream file;
+    if (!input.empty())
+    {
+        file.open(input.c_str());
+        if (!file)
+        {
+            std::cerr << "cannot open " << input << std::endl;
+            return 1;
+        }
+    }
+    std::istream& stream = input.empty() ? std::cin : file;
+
+    std::string line;
+    while (std::getline(stream, line))
+    {
+        std::string::size_type marker = line.find(CallstackBinary::Marker());
+        if (marker == std::string::npos)
+        {
+            std::cout << line << std::endl;
+            continue;
+        }
+        std::string::size_type begin = marker + std::strlen(CallstackBinary::Marker());
+        std::string::size_type end   = line.find_first_of(" \t\r", begin);
+        CallstackRecord        record;
+        std::cout << line.substr(0, marker);
+        if (end != std::string::npos)
+        {
+            std::cout << line.substr(end);
+        }
+        std::cout << std::endl;
+        if (CallstackBinary::Parse(line.substr(begin, end - begin), record))
+        {
+            Print(record, binaries, addr2line);
+        }
+        else
+        {
+            std::cout << "<corrupted callstack record>" << std::endl;
+        }
+    }
+    return 0;
+}
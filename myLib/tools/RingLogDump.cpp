@@ -0,0 +1,92 @@
+// Host side reader of the circular logs written by spdlog::sinks::mmap_ring_sink.
+//
+// Usage: ring-log-dump [-i] <ring file>...
+//
+// Prints the messages kept by each ring file, oldest first. A ring taken from a crashed process
+// holds the messages up to the crash. -i prints the header of the rings instead.
+
+#include <spdlog/details/mmap_ring_helper.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+bool PrintInfo(std::string const& path)
+{
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        std::cerr << "cannot open " << path << std::endl;
+        return false;
+    }
+    spdlog::details::mmap_ring_header header;
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1 && header.valid();
+    std::fclose(file);
+    if (!valid)
+    {
+        std::cerr << path << " is not a ring file" << std::endl;
+        return false;
+    }
+    std::cout << path << ": capacity " << header.capacity << ", written " << header.written
+              << (header.written > header.capacity ? " (wrapped)" : "") << ", oldest record at " << header.oldest
+              << std::endl;
+    return true;
+}
+
+bool PrintMessages(std::string const& path)
+{
+    try
+    {
+        std::cout << spdlog::details::mmap_ring_helper::read(path);
+    }
+    catch (spdlog::spdlog_ex const& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    bool                     info = false;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-i") == 0)
+        {
+            info = true;
+        }
+        else if (argv[i][0] != '-')
+        {
+            inputs.push_back(argv[i]);
+        }
+        else
+        {
+            inputs.clear();
+            break;
+        }
+    }
+    if (inputs.empty())
+    {
+        std::cerr << "usage: " << argv[0] << " [-i] <ring file>..." << std::endl;
+        return 1;
+    }
+
+    int result = 0;
+    for (std::string const& input : inputs)
+    {
+        if (!(info ? PrintInfo(input) : PrintMessages(input)))
+        {
+            result = 1;
+        }
+    }
+    return result;
+}